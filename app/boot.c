@@ -0,0 +1,66 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Boot timeline.
+ */
+
+#include "boot.h"
+
+#include "timebase.h"
+
+// ------------------------------------------------------------------------
+// Private data
+
+static const char *phaseNames[BOOT_NUM_PHASES] = {
+    "app init",
+    "HAL open",
+    "reset released",
+    "hub ready",
+    "sh2 open",
+    "first config",
+    "first sample",
+};
+
+static volatile bool reached[BOOT_NUM_PHASES];
+static uint32_t phaseTime_us[BOOT_NUM_PHASES];
+
+// ------------------------------------------------------------------------
+// Public API
+
+void boot_mark(BootPhase_t phase)
+{
+    if (!reached[phase]) {
+        phaseTime_us[phase] = (uint32_t)timebase_nowUs();
+        reached[phase] = true;
+    }
+}
+
+bool boot_time(BootPhase_t phase, uint32_t *pTime_us)
+{
+    if (!reached[phase]) {
+        return false;
+    }
+    *pTime_us = phaseTime_us[phase];
+    
+    return true;
+}
+
+const char *boot_phaseName(BootPhase_t phase)
+{
+    return phaseNames[phase];
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Boot timeline.
+ *
+ * Startup code marks the end of each phase of getting from MCU reset to
+ * the first sensor sample.  Only the first time each phase is reached is
+ * kept, so later sensor hub resets do not disturb the timeline.  Times
+ * are microseconds on the time base (timebase.h), which starts just after
+ * the system clock is configured.
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Phases, in the order they are normally reached
+typedef enum {
+    BOOT_APP_INIT,          // application init started
+    BOOT_HAL_OPEN,          // sensor hub HAL open started
+    BOOT_RESET_RELEASED,    // sensor hub reset deasserted
+    BOOT_HUB_READY,         // sensor hub interrupt after reset
+    BOOT_SH2_OPEN,          // sh2_open returned
+    BOOT_FIRST_CONFIG,      // first sensor configured
+    BOOT_FIRST_SAMPLE,      // first sensor sample received
+    BOOT_NUM_PHASES
+} BootPhase_t;
+
+// Mark a phase reached now, if not already reached.
+// Callable from interrupts.
+void boot_mark(BootPhase_t phase);
+
+// Get the time a phase was reached.  Returns false if not reached yet.
+bool boot_time(BootPhase_t phase, uint32_t *pTime_us);
+
+// Name of a phase, for reports
+const char *boot_phaseName(BootPhase_t phase);
+
+#endif
@@ -25,6 +25,8 @@
 #include <string.h>
 
 #include "demo_app.h"
+#include "console.h"
+#include "log.h"
 #include "sh2.h"
 #include "sh2_err.h"
 #include "sh2_hal_init.h"
@@ -35,6 +37,7 @@ static void eventHandler(void * cookie, sh2_AsyncEvent_t *pEvent);
 static void reportProdIds(void);
 static void startCal(void);
 static void serviceCal(void);
+static void onLine(void *cookie, const char *line);
 
 // --- Private data ---------------------------------------------------
 
@@ -65,6 +68,9 @@ typedef enum
 
 static CalState_t calState;
 
+// Set by the console line handler, cleared when serviceCal acts on it
+static bool enterPressed = false;
+
 // --- Public methods -------------------------------------------------
 
 // Called once during system initialization
@@ -82,7 +88,7 @@ void demo_init(void)
     status = sh2_open(pSh2Hal, eventHandler, NULL);
     if (status != SH2_OK)
     {
-        printf("Error, %d, from sh2_open.\n", status);
+        log_msg(LOG_SH2_OPEN_ERROR, status);
     }
 
     // resetOccurred would have been set earlier.
@@ -92,6 +98,9 @@ void demo_init(void)
     // Read and display sensor hub product ids
     reportProdIds();
 
+    // Take operator input without blocking sensor hub service
+    console_setLineHandler(onLine, NULL);
+
     // Init calibration process
     startCal();
 }
@@ -136,7 +145,7 @@ static void reportProdIds(void)
     status = sh2_getProdIds(&prodIds);
     
     if (status < 0) {
-        printf("Error from sh2_getProdIds.\n");
+        log_msg(LOG_PROD_IDS_ERROR);
         return;
     }
 
@@ -156,16 +165,23 @@ static void startCal(void)
     printf("Put module in start orientation, press ENTER.\n");
     printf("> ");
 
-    // Set state
+    // Set state, ignoring any ENTER pressed before the prompt
+    enterPressed = false;
     calStatus = SH2_CAL_SUCCESS;
     calState = CAL_WAIT_START;
 }
 
+// Console line handler: any line, even an empty one, counts as ENTER.
+static void onLine(void *cookie, const char *line)
+{
+    enterPressed = true;
+}
+
 static bool pressedEnter(void)
 {
-    char c = getchar();
-    if (c == '\n')
+    if (enterPressed)
     {
+        enterPressed = false;
         return true;
     }
     else
@@ -187,7 +203,7 @@ static void serviceCal(void)
                 if (status != SH2_OK)
                 {
                     // End calibration process with error
-                    printf("Error from sh2_startCal: %d\n", status);
+                    log_msg(LOG_CAL_START_ERROR, status);
                     calState = CAL_DONE;
                 }
                 else
@@ -207,7 +223,7 @@ static void serviceCal(void)
                 if (status != SH2_OK)
                 {
                     // End calibration process with error
-                    printf("Error from sh2_finishCal: %d\n", status);
+                    log_msg(LOG_CAL_FINISH_ERROR, status);
                 }
                 else if (calStatus != 0)
                 {
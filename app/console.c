@@ -23,22 +23,57 @@
 #include "console.h"
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <stm32f4xx_hal.h>
 #include <string.h>
 
 #include "usart.h"
+#include "dbg.h"
+#include "ring.h"
+#include "log.h"
 
-#define CONSOLE_BUFLEN (128)
+// Receive buffer size, a power of 2.  (Override at build time for more or less buffering.)
+#ifndef CONSOLE_RX_BUFLEN
+#define CONSOLE_RX_BUFLEN (1024)
+#endif
 
-// ------------------------------------------------------------------------
-// Private types
+// Receive DMA buffer size, a power of 2.  Received data is moved to the
+// receive buffer when each half fills and when the line goes idle.
+#define CONSOLE_RX_DMA_LEN (64)
+
+// Transmit buffer size, a power of 2.  (Override at build time for more or less buffering.)
+#ifndef CONSOLE_TX_BUFLEN
+#define CONSOLE_TX_BUFLEN (2048)
+#endif
+
+// What to do when the transmit buffer is full, until console_setPolicy is called.
+#ifndef CONSOLE_TX_POLICY
+#define CONSOLE_TX_POLICY CONSOLE_DROP_NEWEST
+#endif
+
+// Initial baud rate.  (Override at build time, e.g. 921600 or 2000000.)
+#ifndef CONSOLE_BAUD
+#define CONSOLE_BAUD (115200)
+#endif
+
+// Lowest baud rate accepted by console_changeBaud
+#define CONSOLE_BAUD_MIN (1200)
+
+// Rates tried by console_autoBaud, fastest first.  (Rates above PCLK1/16
+// are skipped.)
+static const uint32_t autoBaudRates[] = {
+    2000000, 921600, 460800, 230400, 115200,
+};
+
+// Longest line of input passed to the line handler.  (Longer lines are truncated.)
+#define CONSOLE_LINE_MAX (80)
 
-typedef struct Fifo_s {
-    uint8_t *buffer;
-    uint32_t buflen;
-    volatile unsigned nextIn;
-    volatile unsigned nextOut;
-} Fifo_t;
+// Longest run of text passed to the text handler at once
+#define CONSOLE_TEXT_MAX (64)
+
+// Longest span handed to the transmit DMA at once.
+// This bounds the wait for space to be reclaimed after dropping old lines.
+#define CONSOLE_TX_SPAN_MAX (128)
 
 // ------------------------------------------------------------------------
 // Private state variables
@@ -46,33 +81,90 @@ typedef struct Fifo_s {
 // The UART used by the console
 static UART_HandleTypeDef consoleUart; 
 
-// Transmit support
-static uint8_t txFifoBuffer[CONSOLE_BUFLEN];
-static Fifo_t txFifo;
-static volatile bool txActive;  // true if a call to HAL_UART_Transmit_IT is in flight
-static uint8_t txBuffer[CONSOLE_BUFLEN];
+// DMA stream for console Tx
+static DMA_HandleTypeDef consoleTxDma;
+
+// DMA stream for console Rx
+static DMA_HandleTypeDef consoleRxDma;
+
+// Transmit support.
+// The first txPending bytes of txRing are being sent by DMA (or were dropped
+// while it ran), the rest are queued.
+static uint8_t txRingBuffer[CONSOLE_TX_BUFLEN];
+static Ring_t txRing;
+static volatile bool txActive;  // true if a call to HAL_UART_Transmit_DMA is in flight
+static volatile unsigned txPending; // bytes to release from txRing when DMA completes
+static volatile bool txReclaiming; // old lines dropped, space frees when DMA completes
+static volatile bool txMidLine;    // queued data continues a line given to DMA
+static unsigned txLineLen;         // bytes of the current line in txRing
+static bool txDropping;            // discarding the rest of the current line
+static unsigned txEndOwed;         // bytes of CR LF still to queue after a dropped line
+static ConsolePolicy_t txPolicy = CONSOLE_TX_POLICY;
+static uint32_t txDroppedBytes;
+static uint32_t txDroppedLines;
+static uint32_t txDroppedRecords;
+static uint32_t txRawEnd;          // txRing head after the last binary record
+
+// Performance counters
+// The interrupts share one priority, so neither preempts the other.
+// Main context cycles are counted apart, as the interrupts could preempt
+// its read-modify-write.
+static volatile uint32_t irqCount;    // console interrupts serviced
+static uint32_t txCycles;             // CPU cycles on output, main context
+static volatile uint32_t txIrqCycles; // CPU cycles on output, interrupts
+static uint32_t lineCount;          // lines written
 
 // Receive support
-static uint8_t rxFifoBuffer[CONSOLE_BUFLEN];
-static Fifo_t rxFifo;
-static volatile bool rxActive;  // true if a call to HAL_UART_Recieve_IT is in flight
-static uint8_t rxChar;
+// Circular DMA fills rxDmaBuffer, interrupts move the data to rxRing.
+static uint8_t rxDmaBuffer[CONSOLE_RX_DMA_LEN];
+static uint32_t rxDmaOut;  // next index of rxDmaBuffer to move to rxRing
+static uint8_t rxRingBuffer[CONSOLE_RX_BUFLEN];
+static Ring_t rxRing;
 static uint32_t rxDrops;
 
+// Line editor
+static ConsoleLineHandler_t *lineHandler;
+static void *lineCookie;
+static char lineBuf[CONSOLE_LINE_MAX+1];
+static unsigned lineLen;
+static bool lineLastCr;  // previous char was CR, so a following LF is ignored
+
+// Text diverted from the UART while it carries binary data
+static ConsoleTextHandler_t *textHandler;
+static uint8_t textBuf[CONSOLE_TEXT_MAX];
+static unsigned textLen;
+
+// Baud rate change
+typedef enum {
+    BAUD_IDLE,        // no change in progress
+    BAUD_DRAINING,    // sending output queued before the change, at the old rate
+    BAUD_CONFIRMING,  // at the new rate, waiting for CONSOLE_BAUD_CONFIRM
+} BaudState_t;
+
+static volatile BaudState_t baudState;
+static volatile uint32_t baudHoldAt;  // txRing head when the change was requested
+static uint32_t baudNext;             // rate to switch to when drained
+static bool baudConfirm;              // wait for confirmation at baudNext
+static bool baudAnnounce;             // tell the host the new rate is up
+static uint32_t baudPrevious;         // rate to go back to if not confirmed
+static uint32_t baudTimeout_ms;
+static uint32_t baudDeadline_ms;
+static bool baudAuto;                 // trying autoBaudRates
+static unsigned baudAutoIndex;        // next autoBaudRates entry to try
+
 // ------------------------------------------------------------------------
 // Forward declarations
 
 static void startTx(void);
-static void consoleRxCplt(UART_HandleTypeDef *huart);
+static void txPutRun(const uint8_t *pData, unsigned len);
+static void txNewline(void);
+static void textPut(const uint8_t *pData, unsigned len);
+static void echo(int c);
+static void rxCheck(void);
+static void requestBaud(uint32_t baud, bool confirm);
+static bool nextAutoBaud(uint32_t *pBaud);
 static void consoleTxCplt(UART_HandleTypeDef *huart);
 
-// FIFO Operations
-static void fifo_init(Fifo_t *fifo, uint8_t *pBuf, uint32_t bufLen);
-static bool fifo_isEmpty(Fifo_t *fifo);
-static unsigned fifo_insert(Fifo_t *fifo, uint8_t *pData, unsigned len);
-static unsigned fifo_insert1(Fifo_t *fifo, uint8_t c);
-static unsigned fifo_remove(Fifo_t *fifo, uint8_t *pData, unsigned len);
-
 // ------------------------------------------------------------------------
 // Public API
 
@@ -96,7 +188,7 @@ void console_init(void)
 
     // Init UART itself
     consoleUart.Instance = USART2;
-    consoleUart.Init.BaudRate = 115200;
+    consoleUart.Init.BaudRate = CONSOLE_BAUD;
     consoleUart.Init.WordLength = UART_WORDLENGTH_8B;
     consoleUart.Init.StopBits = UART_STOPBITS_1;
     consoleUart.Init.Parity = UART_PARITY_NONE;
@@ -105,22 +197,195 @@ void console_init(void)
     consoleUart.Init.OverSampling = UART_OVERSAMPLING_16;
     HAL_UART_Init(&consoleUart);
 
-    // Register for rxCplt and txCplt callbacks on console uart
-    usartRegisterHandlers(&consoleUart, consoleRxCplt, consoleTxCplt);
-
-    // Init FIFOs
-    fifo_init(&txFifo, txFifoBuffer, sizeof(txFifoBuffer));
-    fifo_init(&rxFifo, rxFifoBuffer, sizeof(rxFifoBuffer));
+    // Transmit via DMA1 stream 6, channel 4
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    consoleTxDma.Instance = DMA1_Stream6;
+    consoleTxDma.Init.Channel = DMA_CHANNEL_4;
+    consoleTxDma.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    consoleTxDma.Init.PeriphInc = DMA_PINC_DISABLE;
+    consoleTxDma.Init.MemInc = DMA_MINC_ENABLE;
+    consoleTxDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    consoleTxDma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    consoleTxDma.Init.Mode = DMA_NORMAL;
+    consoleTxDma.Init.Priority = DMA_PRIORITY_LOW;
+    consoleTxDma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&consoleTxDma);
+    __HAL_LINKDMA(&consoleUart, hdmatx, consoleTxDma);
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 7, 0);
+
+    // Receive via DMA1 stream 5, channel 4
+    consoleRxDma.Instance = DMA1_Stream5;
+    consoleRxDma.Init.Channel = DMA_CHANNEL_4;
+    consoleRxDma.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    consoleRxDma.Init.PeriphInc = DMA_PINC_DISABLE;
+    consoleRxDma.Init.MemInc = DMA_MINC_ENABLE;
+    consoleRxDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    consoleRxDma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    consoleRxDma.Init.Mode = DMA_CIRCULAR;
+    consoleRxDma.Init.Priority = DMA_PRIORITY_LOW;
+    consoleRxDma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&consoleRxDma);
+    __HAL_LINKDMA(&consoleUart, hdmarx, consoleRxDma);
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 7, 0);
+
+    // Register for txCplt callbacks on console uart.
+    // (Receive is handled by rxDrain from the interrupt handlers.)
+    usartRegisterHandlers(&consoleUart, 0, consoleTxCplt);
+
+    // Init ring buffers
+    ring_init(&txRing, txRingBuffer, sizeof(txRingBuffer));
+    ring_init(&rxRing, rxRingBuffer, sizeof(rxRingBuffer));
 
     // Transmit inactive initially
     txActive = false;
     
     // Start receiving characters
-    rxActive = true;
-    HAL_UART_Receive_IT(&consoleUart, &rxChar, 1);
+    rxCheck();
     
     // Enable interrupts now that we're ready.
     HAL_NVIC_EnableIRQ(USART2_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+void console_service(void)
+{
+    uint8_t c;
+    uint32_t baud;
+
+    rxCheck();
+
+    if ((baudState == BAUD_CONFIRMING) &&
+        ((int32_t)(HAL_GetTick() - baudDeadline_ms) >= 0)) {
+        // New rate not confirmed: try the next one, or go back to the old one
+        if (baudAuto && nextAutoBaud(&baud)) {
+            requestBaud(baud, true);
+        }
+        else {
+            baudAuto = false;
+            requestBaud(baudPrevious, false);
+            log_msg(LOG_BAUD_REVERTED, baudPrevious);
+        }
+    }
+    if (baudState == BAUD_DRAINING) {
+        // Switches rate once the output queued before the change is sent
+        startTx();
+    }
+    if (baudAnnounce) {
+        // At the new rate, tell the host how to keep it
+        baudAnnounce = false;
+        printf("Console at %u baud.  Send \"%s\" to keep this rate.\n",
+               (unsigned)consoleUart.Init.BaudRate, CONSOLE_BAUD_CONFIRM);
+    }
+
+    if (lineHandler == 0) {
+        // Input is left for getchar
+        return;
+    }
+
+    while (ring_remove(&rxRing, &c, 1) != 0) {
+        if ((c == '\n') && lineLastCr) {
+            // Second half of CR LF
+            lineLastCr = false;
+            continue;
+        }
+        lineLastCr = (c == '\r');
+
+        if ((c == '\r') || (c == '\n')) {
+            // Line complete
+            echo('\n');
+            lineBuf[lineLen] = 0;
+            lineLen = 0;
+            if (baudState == BAUD_CONFIRMING) {
+                // Until the host confirms the new rate, input may be garbage
+                if (strcmp(lineBuf, CONSOLE_BAUD_CONFIRM) == 0) {
+                    baudState = BAUD_IDLE;
+                    baudAuto = false;
+                    log_msg(LOG_BAUD_CONFIRMED, consoleUart.Init.BaudRate);
+                }
+                continue;
+            }
+            lineHandler(lineCookie, lineBuf);
+        }
+        else if ((c == '\b') || (c == 0x7F)) {
+            // Backspace: erase last char
+            if (lineLen > 0) {
+                lineLen--;
+                echo('\b');
+                echo(' ');
+                echo('\b');
+            }
+        }
+        else if ((c >= ' ') && (lineLen < CONSOLE_LINE_MAX)) {
+            lineBuf[lineLen++] = (char)c;
+            echo(c);
+        }
+    }
+}
+
+void console_setLineHandler(ConsoleLineHandler_t *handler, void *cookie)
+{
+    lineLen = 0;
+    lineLastCr = false;
+    lineCookie = cookie;
+    lineHandler = handler;
+}
+
+void console_getStats(ConsoleStats_t *pStats)
+{
+    pStats->lines = lineCount;
+    pStats->irqs = irqCount;
+    pStats->txCycles = txCycles + txIrqCycles;
+    pStats->rxDrops = rxDrops;
+    pStats->droppedBytes = txDroppedBytes;
+    pStats->droppedLines = txDroppedLines;
+    pStats->droppedRecords = txDroppedRecords;
+}
+
+bool console_changeBaud(uint32_t baud, uint32_t confirmTimeout_ms)
+{
+    if ((baudState != BAUD_IDLE) ||
+        (baud < CONSOLE_BAUD_MIN) || (baud > HAL_RCC_GetPCLK1Freq() / 16)) {
+        return false;
+    }
+
+    baudPrevious = consoleUart.Init.BaudRate;
+    baudTimeout_ms = confirmTimeout_ms;
+    baudAuto = false;
+    requestBaud(baud, (confirmTimeout_ms != 0));
+    
+    return true;
+}
+
+bool console_autoBaud(uint32_t stepTimeout_ms)
+{
+    uint32_t baud;
+
+    if ((baudState != BAUD_IDLE) || (stepTimeout_ms == 0)) {
+        return false;
+    }
+
+    baudPrevious = consoleUart.Init.BaudRate;
+    baudTimeout_ms = stepTimeout_ms;
+    baudAuto = true;
+    baudAutoIndex = 0;
+    if (!nextAutoBaud(&baud)) {
+        baudAuto = false;
+        return false;
+    }
+    requestBaud(baud, true);
+
+    return true;
+}
+
+uint32_t console_getBaud(void)
+{
+    return consoleUart.Init.BaudRate;
+}
+
+void console_setPolicy(ConsolePolicy_t policy)
+{
+    txPolicy = policy;
 }
 
 size_t __read(int Handle, unsigned char * Buf, size_t BufSize)
@@ -132,218 +397,554 @@ size_t __read(int Handle, unsigned char * Buf, size_t BufSize)
         return -1;
     }
 
-    copied = fifo_remove(&rxFifo, Buf, BufSize);
+    copied = ring_remove(&rxRing, Buf, BufSize);
 
     return copied;
 }
 
+// Never waits for input, so sensor servicing carries on: returns EOF if
+// nothing has been received.  (Interactive input is better read a line at
+// a time with console_setLineHandler.)
 int getchar(void)
 {
-    uint8_t c = -1;
-        
-    if (!rxActive) {
-        // Start receiving.
-        rxActive = true;
-        HAL_UART_Receive_IT(&consoleUart, &rxChar, 1);
-    }
+    uint8_t c;
 
-    while (fifo_isEmpty(&rxFifo)) {
-        // Wait for data
+    rxCheck();
+    if (ring_remove(&rxRing, &c, 1) == 0) {
+        return EOF;
     }
-
-    fifo_remove(&rxFifo, &c, 1);
     
     // translate CR to LF
     if (c == '\r') {
         c = '\n';
     }
         
-    // echo
-    putchar(c);
+    echo(c);
 
     return (int)c;
 }
 
 size_t __write(int Handle, const unsigned char * Buf, size_t Bufsize)
 {
-    size_t n;
-    int rc;
+    uint32_t start;
+    const unsigned char *p = Buf;
+    const unsigned char *end = Buf + Bufsize;
+    const unsigned char *nl;
 
     // This function only works for stdout, stderr
     if (!((Handle == 1) || (Handle == 2))) {
         return -1;
     }
 
-    for (n = 0; n < Bufsize; n++) {
-        rc = putchar(Buf[n]);
-        if (rc < 0) break;
+    // Nothing to flush
+    if (Bufsize == 0) {
+        return 0;
+    }
+
+    if (textHandler != 0) {
+        textPut(Buf, Bufsize);
+        return Bufsize;
     }
 
-    return n;
+    start = dbg_cycles();
+
+    // Queue each run of characters up to a newline in bulk
+    while (p < end) {
+        nl = memchr(p, '\n', end - p);
+        if (nl == 0) {
+            txPutRun(p, end - p);
+            break;
+        }
+        txPutRun(p, nl - p);
+        txNewline();
+        p = nl + 1;
+    }
+
+    // Activate transmission if not already active
+    startTx();
+
+    txCycles += dbg_cycles() - start;
+
+    return Bufsize;
 }
 
 int putchar(int c)
 {
-    // insert CF before each LF
-    if (c == '\n') {
-        fifo_insert1(&txFifo, '\r');
+    uint32_t start = dbg_cycles();
+    uint8_t ch = (uint8_t)c;
+    
+    if (textHandler != 0) {
+        textPut(&ch, 1);
+        return c;
     }
 
-    // insert this character
-    fifo_insert1(&txFifo, (uint8_t)c);
+    if (c == '\n') {
+        txNewline();
+    }
+    else {
+        // insert this character
+        txPutRun(&ch, 1);
+    }
 
     // Activate transmission if not already active
     startTx();
 
+    txCycles += dbg_cycles() - start;
+
     return c;
 }
 
+bool console_writeRaw(const uint8_t *pData, unsigned len)
+{
+    uint32_t start = dbg_cycles();
+    bool queued = true;
+
+    if (len > sizeof(txRingBuffer)) {
+        return false;
+    }
+
+    // Finish a partly written text line first, so the line dropping
+    // policies only ever see whole text lines at the end of the ring.
+    if (txLineLen != 0) {
+        txNewline();
+    }
+
+    // Wait for room or drop the data, per policy.
+    while (ring_free(&txRing) < len) {
+        if (txPolicy == CONSOLE_BLOCK) {
+            startTx();
+        }
+        else {
+            queued = false;
+            break;
+        }
+    }
+
+    if (queued) {
+        ring_insert(&txRing, pData, len);
+        txRawEnd = txRing.head;
+        startTx();
+    }
+    else {
+        txDroppedBytes += len;
+        txDroppedRecords++;
+    }
+
+    txCycles += dbg_cycles() - start;
+
+    return queued;
+}
+
+void console_setTextHandler(ConsoleTextHandler_t *handler)
+{
+    if ((textHandler != 0) && (textLen > 0)) {
+        // Pass on the end of a partial line
+        textHandler(textBuf, textLen);
+    }
+    textLen = 0;
+    textHandler = handler;
+}
+
 // ------------------------------------------------------------------------
 // Private utility functions
 
-// Process USART2 IRQ through STM32 HAL
-void USART2_IRQHandler(void)
+// Collect text for the text handler, passing it on a line at a time.
+static void textPut(const uint8_t *pData, unsigned len)
 {
-    HAL_UART_IRQHandler(&consoleUart);
+    while (len > 0) {
+        uint8_t c = *pData++;
+        len--;
+
+        textBuf[textLen++] = c;
+        if ((c == '\n') || (textLen == sizeof(textBuf))) {
+            textHandler(textBuf, textLen);
+            textLen = 0;
+        }
+    }
 }
 
-// If transmit inactive, start it.
-static void startTx(void)
+// Echo an input character, unless the console carries binary data.
+static void echo(int c)
+{
+    if (textHandler == 0) {
+        putchar(c);
+    }
+}
+
+// Move data received by DMA into rxRing.
+// Called from the USART2 and DMA1 stream 5 interrupts, which can't preempt each other.
+static void rxDrain(void)
 {
+    uint32_t in = (sizeof(rxDmaBuffer) - __HAL_DMA_GET_COUNTER(&consoleRxDma)) &
+        (sizeof(rxDmaBuffer) - 1);
     unsigned len;
-    
-    // If tx is inactive, start it.
-    if (!txActive) {
-        // Load txBuffer from tx Fifo
-        len = fifo_remove(&txFifo, txBuffer, sizeof(txBuffer));
+    unsigned stored;
+
+    // At most two spans: to the end of the buffer, then from the start.
+    while (rxDmaOut != in) {
+        len = (in > rxDmaOut) ? (in - rxDmaOut) : (sizeof(rxDmaBuffer) - rxDmaOut);
+        stored = ring_insert(&rxRing, &rxDmaBuffer[rxDmaOut], len);
+        if (stored < len) {
+            // rxRing is full, count an overflow
+            rxDrops += len - stored;
+        }
+        rxDmaOut = (rxDmaOut + len) & (sizeof(rxDmaBuffer) - 1);
+    }
+}
+
+// Start DMA reception if it is not running.  The HAL stops it on receive
+// errors (e.g. framing errors from line noise), so this is checked regularly.
+static void rxCheck(void)
+{
+    if ((consoleUart.RxState != HAL_UART_STATE_READY) ||
+        (consoleRxDma.State != HAL_DMA_STATE_READY)) {
+        // Running, or still stopping
+        return;
+    }
+
+    HAL_NVIC_DisableIRQ(DMA1_Stream5_IRQn);
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
+    rxDmaOut = 0;
+    HAL_UART_Receive_DMA(&consoleUart, rxDmaBuffer, sizeof(rxDmaBuffer));
+    __HAL_UART_ENABLE_IT(&consoleUart, UART_IT_IDLE);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+}
+
+// Start a baud rate change.  Output queued so far is sent at the current
+// rate, then startTx switches to the new one.
+static void requestBaud(uint32_t baud, bool confirm)
+{
+    baudNext = baud;
+    baudConfirm = confirm;
+    baudHoldAt = txRing.head;
+    baudState = BAUD_DRAINING;
+}
 
-        if (len > 0) {
-            txActive = true;
-            HAL_UART_Transmit_IT(&consoleUart, txBuffer, len);
+// Find the next rate for console_autoBaud to try.  Returns false if none are left.
+static bool nextAutoBaud(uint32_t *pBaud)
+{
+    while (baudAutoIndex < sizeof(autoBaudRates)/sizeof(autoBaudRates[0])) {
+        uint32_t baud = autoBaudRates[baudAutoIndex++];
+        if (baud <= HAL_RCC_GetPCLK1Freq() / 16) {
+            *pBaud = baud;
+            return true;
         }
     }
+
+    return false;
 }
 
-// When transmit completes
-static void consoleTxCplt(UART_HandleTypeDef *huart)
+// Reprogram the UART for the requested baud rate.  Only called with transmit
+// idle and the last byte out of the shift register.  Partial input is discarded.
+static void switchBaud(void)
 {
-    unsigned len;
+    HAL_NVIC_DisableIRQ(DMA1_Stream5_IRQn);
+    HAL_NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
+    
+    HAL_UART_DMAStop(&consoleUart);
+    consoleUart.Init.BaudRate = baudNext;
+    HAL_UART_Init(&consoleUart);
+    lineLen = 0;
+    lineLastCr = false;
     
-    // One transmission is complete.
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
 
-    // If there is more data to transmit now, immediately start it.
-    len = fifo_remove(&txFifo, txBuffer, 1);
+    // Restart reception
+    rxCheck();
 
-    if (len > 0)
-    {
-        HAL_UART_Transmit_IT(&consoleUart, txBuffer, len);
-    }
-    else
-    {
-        txActive = false;
+    if (!baudConfirm) {
+        baudState = BAUD_IDLE;
+        return;
     }
+
+    // console_service tells the host.  (This may run inside __write.)
+    baudState = BAUD_CONFIRMING;
+    baudDeadline_ms = HAL_GetTick() + baudTimeout_ms;
+    baudAnnounce = true;
 }
 
-// When a receive operation completes.  (We do receive one char at a time.)
-static void consoleRxCplt(UART_HandleTypeDef *huart)
+// Process USART2 IRQ through STM32 HAL
+void USART2_IRQHandler(void)
 {
-    // rxChar now has the latest input.
-    // Insert the new char in input fifo.
-    unsigned len = fifo_insert(&rxFifo, &rxChar, 1);
-    if (len == 0) {
-        // If fifo insert failed, count an overflow
-        rxDrops++;
+    uint32_t start = dbg_cycles();
+    
+    irqCount++;
+
+    // Line went idle: deliver what has been received so far
+    if (__HAL_UART_GET_FLAG(&consoleUart, UART_FLAG_IDLE)) {
+        __HAL_UART_CLEAR_IDLEFLAG(&consoleUart);
+        rxDrain();
     }
+    
+    HAL_UART_IRQHandler(&consoleUart);
+    
+    txIrqCycles += dbg_cycles() - start;
+}
 
-    // Start reception of next character
-    HAL_UART_Receive_IT(&consoleUart, &rxChar, 1);
+// Process console Rx DMA IRQ through STM32 HAL.
+// Interrupts at half and full buffer move received data along.
+void DMA1_Stream5_IRQHandler(void)
+{
+    irqCount++;
+    HAL_DMA_IRQHandler(&consoleRxDma);
+    rxDrain();
 }
 
-// Init a fifo structure
-static void fifo_init(Fifo_t *fifo, uint8_t *pBuf, uint32_t bufLen)
+// Process console Tx DMA IRQ through STM32 HAL
+void DMA1_Stream6_IRQHandler(void)
 {
-    fifo->buffer = pBuf;
-    fifo->buflen = bufLen;
+    uint32_t start = dbg_cycles();
+    
+    irqCount++;
+    HAL_DMA_IRQHandler(&consoleTxDma);
     
-    // Stuff the buffer with dummy data
-    memset(fifo->buffer, 'Z', bufLen);
+    txIrqCycles += dbg_cycles() - start;
+}
 
-    // Set in, out indices to start of buffer.
-    fifo->nextIn = 0;
-    fifo->nextOut = 0;
+// Keep the console transmit interrupts from running
+static void txLock(void)
+{
+    HAL_NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+    HAL_NVIC_DisableIRQ(USART2_IRQn);
 }
 
-// return true if fifo is empty
-static bool fifo_isEmpty(Fifo_t *fifo)
+static void txUnlock(void)
 {
-    unsigned in = fifo->nextIn;
-    unsigned out = fifo->nextOut;
-    return (in == out);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
 }
 
-// Insert up to len bytes in fifo.  Returns length actually inserted
-static unsigned fifo_insert(Fifo_t *fifo, uint8_t *pData, unsigned len)
+// Send the next contiguous span of queued data, if any, directly from the ring buffer.
+// Only called while no DMA is in flight.  Returns true if a transmission was started.
+static bool sendSpan(void)
 {
-    unsigned in;        // local copy of nextIn (we will only update the real nextIn once.)
-    unsigned beyondIn;  // one index position beyond in, with wrap
-    unsigned n;         // index into pData
+    uint8_t *pData;
+    unsigned len = ring_peek(&txRing, 0, &pData);
 
-    n = 0;
-    in = fifo->nextIn;
-    beyondIn = in + 1;
-    if (beyondIn >= fifo->buflen)
-    {
-        beyondIn = 0;
+    if (len == 0) {
+        return false;
+    }
+    if (len > CONSOLE_TX_SPAN_MAX) {
+        len = CONSOLE_TX_SPAN_MAX;
+    }
+    if (baudState == BAUD_DRAINING) {
+        // Output queued after a baud rate change waits for the new rate
+        int32_t held = (int32_t)(baudHoldAt - txRing.tail);
+        if (held <= 0) {
+            return false;
+        }
+        if (len > (unsigned)held) {
+            len = (unsigned)held;
+        }
     }
     
-    // While there is data to insert and room to insert it...
-    while ((n < len) && (beyondIn != fifo->nextOut)) {
-        fifo->buffer[in] = pData[n];
+    txPending = len;
+    txMidLine = (pData[len - 1] != '\n');
+    HAL_UART_Transmit_DMA(&consoleUart, pData, len);
+
+    return true;
+}
+
+// Discard the current line.  If none of it has been given to DMA yet, the
+// part already queued is removed.  Otherwise the part not yet given to DMA is
+// removed and the line is terminated where the DMA stops.
+static void dropCurrentLine(void)
+{
+    unsigned unsent;
+
+    txLock();
+    unsent = ring_used(&txRing) - txPending;
+    if (txLineLen <= unsent) {
+        ring_unwrite(&txRing, txLineLen);
+        txDroppedBytes += txLineLen;
+    }
+    else {
+        // Lines dropped while the DMA is in flight may still fill the ring,
+        // so the line ending may not fit yet.  txNewline queues what didn't.
+        ring_unwrite(&txRing, unsent);
+        txDroppedBytes += unsent;
+        txEndOwed = 2 - ring_insert(&txRing, (const uint8_t *)"\r\n", 2);
+    }
+    txLineLen = 0;
+    txUnlock();
+
+    txDropping = true;
+}
+
+// Discard the oldest line that is queued but not yet given to DMA.
+// If part of that line was already given to DMA, only its line ending is kept.
+// Returns false if there is no such line.  Binary data may hold '\n' bytes,
+// so nothing is dropped while any of it is still queued.
+static bool dropOldestLine(void)
+{
+    bool found = false;
+    unsigned start;
+    unsigned end;
+    unsigned unsent;
+    unsigned n;
+    unsigned dropLen = 0;
+
+    txLock();
+    
+    // If DMA has started on the current line, no complete line is queued
+    // behind it.  (dropCurrentLine handles the current line.)
+    unsent = ring_used(&txRing) - txPending;
+    if (txLineLen > unsent) {
+        txUnlock();
+        return false;
+    }
+
+    // Don't cut into binary data from console_writeRaw
+    if ((int32_t)(txRawEnd - (txRing.tail + txPending)) > 0) {
+        txUnlock();
+        return false;
+    }
+
+    // Find the end of the oldest queued line
+    start = txPending;
+    end = ring_used(&txRing) - txLineLen;
+    n = start;
+    while ((n != end) && !found) {
+        found = (ring_at(&txRing, n) == '\n');
         n++;
-        in = beyondIn;
-        beyondIn++;
-        if (beyondIn > fifo->buflen)
-        {
-            beyondIn = 0;
+    }
+
+    if (found) {
+        dropLen = n - start;
+        if (txMidLine) {
+            // Keep CR LF to terminate the part already sent.
+            dropLen = (dropLen > 2) ? (dropLen - 2) : 0;
         }
     }
 
-    // Update input pointer once
-    fifo->nextIn = in;
+    if (dropLen > 0) {
+        txDroppedBytes += dropLen;
+        txDroppedLines++;
+        if (txActive) {
+            // Space is reclaimed when the DMA in flight completes
+            txPending += dropLen;
+            txReclaiming = true;
+        }
+        else {
+            ring_consume(&txRing, dropLen);
+        }
+    }
+    
+    txUnlock();
 
-    // Copied this many bytes
-    return n;
+    return (dropLen > 0);
 }
 
-// Insert one byte in fifo.  Returns 1 if successful, otherwise 0
-static unsigned fifo_insert1(Fifo_t *fifo, uint8_t c)
+// Queue characters for transmit, applying the full buffer policy.
+static void txPutRun(const uint8_t *pData, unsigned len)
 {
-    return fifo_insert(fifo, &c, 1);
+    unsigned stored;
+    
+    while (len > 0) {
+        if (txDropping) {
+            // Rest of the current line is being discarded
+            txDroppedBytes += len;
+            return;
+        }
+
+        stored = ring_insert(&txRing, pData, len);
+        txLineLen += stored;
+        pData += stored;
+        len -= stored;
+        if (len == 0) {
+            break;
+        }
+        
+        // Buffer is full
+        if (txPolicy == CONSOLE_BLOCK) {
+            // Wait for the transmitter to make room
+            startTx();
+        }
+        else if ((txPolicy == CONSOLE_DROP_OLDEST) &&
+                 (txReclaiming || dropOldestLine())) {
+            // Wait for dropped lines to be reclaimed
+            startTx();
+        }
+        else {
+            dropCurrentLine();
+            txDroppedBytes += len;
+            return;
+        }
+    }
 }
 
-// Remove up to len bytes from fifo.  Returns length actually removed
-static unsigned fifo_remove(Fifo_t *fifo, uint8_t *pData, unsigned len)
+// Queue the part of a dropped line's CR LF that didn't fit when it was
+// dropped.  Room is made when the DMA in flight completes.
+static void txEndDropped(void)
 {
-    unsigned out;        // local copy of nextOut
-    unsigned n;          // index into pData
+    const uint8_t *pEnd = (const uint8_t *)"\r\n";
 
-    n = 0;
-    out = fifo->nextOut;
+    while (txEndOwed > 0) {
+        txEndOwed -= ring_insert(&txRing, pEnd + 2 - txEndOwed, txEndOwed);
+        if (txEndOwed > 0) {
+            startTx();
+        }
+    }
+}
 
-    // While there is space to read to and data to read
-    while ((n < len) && (out != fifo->nextIn)) {
-        pData[n] = fifo->buffer[out];
-        n++;
-        out++;
-        if (out >= fifo->buflen)
-        {
-            out = 0;
+// End the current line, inserting CR before LF.
+static void txNewline(void)
+{
+    if (txDropping) {
+        // The discarded line ends here.
+        txDropping = false;
+        txDroppedLines++;
+    }
+    else {
+        txPutRun((const uint8_t *)"\r\n", 2);
+        if (txDropping) {
+            txDropping = false;
+            txDroppedLines++;
+        }
+        else {
+            lineCount++;
+        }
+    }
+    txEndDropped();
+    txLineLen = 0;
+}
+
+// If transmit inactive, start it.
+static void startTx(void)
+{
+    // If tx is inactive, start it.
+    if (!txActive) {
+        txActive = true;
+        if (!sendSpan()) {
+            txActive = false;
         }
     }
 
-    // Update input pointer once
-    fifo->nextOut = out;
+    // Once a pending baud rate change has nothing left to send at the old
+    // rate and the last byte has left the shift register, switch.
+    if ((baudState == BAUD_DRAINING) && !txActive &&
+        ((int32_t)(baudHoldAt - txRing.tail) <= 0) &&
+        __HAL_UART_GET_FLAG(&consoleUart, UART_FLAG_TC)) {
+        switchBaud();
+    }
+}
 
-    // Copied this many bytes
-    return n;
+// When transmit completes
+static void consoleTxCplt(UART_HandleTypeDef *huart)
+{
+    // One transmission is complete, release that span of the ring
+    // along with any queued lines dropped meanwhile.
+    ring_consume(&txRing, txPending);
+    txPending = 0;
+    txReclaiming = false;
+
+    // If there is more data to transmit now, immediately start it.
+    if (!sendSpan())
+    {
+        txActive = false;
+    }
 }
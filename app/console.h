@@ -24,6 +24,91 @@
 #ifndef CONSOLE_H
 #define CONSOLE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+// What to do with output when the transmit buffer is full
+typedef enum {
+    CONSOLE_BLOCK,        // wait for the transmitter to make room
+    CONSOLE_DROP_NEWEST,  // discard the line being written
+    CONSOLE_DROP_OLDEST,  // discard the oldest queued lines to make room
+} ConsolePolicy_t;
+
+// Console performance counters
+typedef struct {
+    uint32_t lines;          // lines written
+    uint32_t irqs;           // console interrupts serviced
+    uint32_t txCycles;       // CPU cycles spent queueing and transmitting output
+    uint32_t rxDrops;        // received characters dropped on input overflow
+    uint32_t droppedBytes;   // output bytes discarded because the buffer was full
+    uint32_t droppedLines;   // output lines discarded, in whole or in part
+    uint32_t droppedRecords; // console_writeRaw records discarded
+} ConsoleStats_t;
+
+// Called from console_service with each line entered, without its line ending.
+typedef void (ConsoleLineHandler_t)(void *cookie, const char *line);
+
+// Called with text written to stdout while the console carries binary data.
+typedef void (ConsoleTextHandler_t)(const uint8_t *pText, unsigned len);
+
 void console_init(void);
 
+// Process received characters: echo, line editing and the line handler.
+// Call from the main loop.  Never blocks.
+void console_service(void);
+
+// Register a handler for lines of console input.
+// While one is registered, console_service consumes all input.
+void console_setLineHandler(ConsoleLineHandler_t *handler, void *cookie);
+
+// Line the host sends to confirm a new baud rate
+#define CONSOLE_BAUD_CONFIRM "ok"
+
+// Change the console baud rate.  Output already queued is sent at the
+// current rate, then console_service switches to the new one.
+// If confirmTimeout_ms is non-zero, the console announces the new rate and
+// the previous rate is restored unless the line CONSOLE_BAUD_CONFIRM
+// arrives at the new rate within that time.  (So a host can try a rate and
+// fall back if its serial port can't use it.)  Other input is discarded
+// until then, so line noise at the wrong rate can't confirm it or reach
+// the line handler.
+// Returns false, without changing anything, if the rate is not supported
+// or a change is already in progress.
+//
+// Rates up to PCLK1/16 (2.625 Mbaud at 42MHz) are supported.  921600 runs
+// at 913043 (-0.9%), 2000000 is exact.  At 10 bits per byte the line rate
+// limits output to about 11.5 KB/s at 115200, 91 KB/s at 921600 and
+// 200 KB/s at 2000000, or roughly 160, 1300 and 2800 rotation vector text
+// lines per second.  The stats command shows what is actually sustained.
+bool console_changeBaud(uint32_t baud, uint32_t confirmTimeout_ms);
+
+// Negotiate the fastest rate the host can use.  Rates from 2000000 down to
+// 115200 are tried in turn, fastest first, each for stepTimeout_ms, as with
+// console_changeBaud.  A host follows the same schedule, sending
+// CONSOLE_BAUD_CONFIRM at each rate until the console's announcement reads
+// correctly.  If no rate is confirmed, the previous rate is restored.
+// Returns false if a change is already in progress.
+bool console_autoBaud(uint32_t stepTimeout_ms);
+
+// Current console baud rate
+uint32_t console_getBaud(void);
+
+// Select the policy used when the transmit buffer is full
+void console_setPolicy(ConsolePolicy_t policy);
+
+// Queue binary data for transmit, without newline translation.
+// The data is queued entirely or, if the policy does not block, dropped.
+// Returns true if it was queued.  Until it has been sent, CONSOLE_DROP_OLDEST
+// drops the line being written rather than lines queued before it.
+bool console_writeRaw(const uint8_t *pData, unsigned len);
+
+// Keep text out of binary data written with console_writeRaw.
+// While a handler is set, text written to stdout is passed to it a line at
+// a time (long lines in pieces) instead of being sent, and input is not
+// echoed.  A null handler returns to sending text.
+void console_setTextHandler(ConsoleTextHandler_t *handler);
+
+// Read console performance counters
+void console_getStats(ConsoleStats_t *pStats);
+
 #endif
@@ -16,7 +16,7 @@
  */
 
 /*
- * GPIO control for debug support
+ * GPIO control and cycle counting for debug support
  */
 
 
@@ -32,7 +32,7 @@
 #define DEBUG2_GPIO_PORT GPIOB
 #define DEBUG2_GPIO_PIN  GPIO_PIN_13
 
-// Initialize debug support (set debug pin as output)
+// Initialize debug support (set debug pin as output, start cycle counter)
 void dbg_init()
 {
     GPIO_InitTypeDef GPIO_InitStruct;
@@ -53,6 +53,17 @@ void dbg_init()
     GPIO_InitStruct.Pull = GPIO_NOPULL;
     GPIO_InitStruct.Speed = GPIO_SPEED_HIGH;
     HAL_GPIO_Init(DEBUG2_GPIO_PORT, &GPIO_InitStruct);
+
+    /* Start the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Read the cycle counter
+uint32_t dbg_cycles()
+{
+    return DWT->CYCCNT;
 }
 
 // Pulse the debug pin high and low <count> times
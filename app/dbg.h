@@ -16,15 +16,20 @@
  */
 
 /*
- * GPIO control for debug.
+ * GPIO control and cycle counting for debug.
  */
 
 #ifndef DBG_H
 #define DBG_H
 
-// Initialize debug pin
+#include <stdint.h>
+
+// Initialize debug pins and the cycle counter
 void dbg_init(void);
 
+// Read the free-running CPU cycle counter (wraps every ~51s at 84MHz)
+uint32_t dbg_cycles(void);
+
 // Pulse the debug pin <count> times, as fast as possible.
 void dbg_pulse(unsigned count);
 
@@ -25,16 +25,34 @@
 // Define this to produce DSF data for logging
 // #define DSF_OUTPUT
 
+// Define this to produce compact binary records (see stream.h) for logging
+// #define BINARY_OUTPUT
+
 // Define this to perform fimware update at startup.
 // #define PERFORM_DFU
 
 // Define this to use HMD-appropriate configuration.
 // #define CONFIGURE_HMD
 
+// Define this to batch sensor reports in the sensor hub, trading latency for
+// fewer sensor hub interrupts.  (Interval in microseconds.)
+// #define BATCH_INTERVAL_US (100000)
+
+// Define this to print console load and sensor event cycle statistics periodically.
+// #define CONSOLE_STATS
+
+// Define this to compare sensor output formatting cost against printf at startup.
+// #define FORMAT_BENCHMARK
+
+// Define this to check and time the orientation conversion kernels at startup.
+// #define ORIENTATION_BENCHMARK
+
 // ------------------------------------------------------------------------
 
 // Sensor Application
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "demo_app.h"
@@ -44,6 +62,19 @@
 #include "sh2_err.h"
 #include "sh2_SensorValue.h"
 #include "sh2_hal_init.h"
+#include "console.h"
+#include "stream.h"
+#include "fmt.h"
+#include "dbg.h"
+#include "log.h"
+#include "samples.h"
+#include "sequence.h"
+#include "resample.h"
+#include "orient.h"
+#include "predict.h"
+#include "timebase.h"
+#include "boot.h"
+#include "stm32f4xx_hal.h"
 
 #ifdef PERFORM_DFU
 #include "dfu.h"
@@ -51,64 +82,272 @@
 
 #ifdef CONFIGURE_HMD
     // Enable GIRV prediction for 28ms with 100Hz sync
-    #define GIRV_PRED_AMT FIX_Q(10, 0.028)             // prediction amt: 28ms
+    #define GIRV_PRED_AMT FIX_Q(10, 0.028f)            // prediction amt: 28ms
 #else
     // Disable GIRV prediction
-    #define GIRV_PRED_AMT FIX_Q(10, 0.0)               // prediction amt: 0
+    #define GIRV_PRED_AMT FIX_Q(10, 0.0f)              // prediction amt: 0
 #endif
 
 #define FIX_Q(n, x) ((int32_t)(x * (float)(1 << n)))
-const float scaleDegToRad = 3.14159265358 / 180.0;
+
+// Report interval for sensors until changed by the rate command
+#define DEFAULT_INTERVAL_US (10000)  // microseconds (100Hz)
+
+// Max length of a line of sensor output
+#define MAX_LINE_LEN (160)
+
+// Time allowed for the host to confirm a new console baud rate
+#define BAUD_CONFIRM_MS (3000)
+
+// Time allowed at each rate tried by "baud auto"
+#define BAUD_AUTO_STEP_MS (1000)
+
+// Interval between console statistics reports
+#define CONSOLE_STATS_INTERVAL_US (5000000)
+
+// Most sensor hub transfers processed per demo_service call
+#define SERVICE_MAX_PASSES (4)
+
+// Interval between checks for lost sensor samples
+#define SEQUENCE_STATS_INTERVAL_US (5000000)
+const float scaleDegToRad = 3.14159265f / 180.0f;
+static const float scaleRadToDeg = 180.0f / 3.14159265f;
+
+// Per-sensor output rate policies, applied before events are decoded
+typedef enum {
+    OUTPUT_ALL,        // output every event
+    OUTPUT_EVERY_NTH,  // output one event in param
+    OUTPUT_MAX_RATE,   // output events at least param us apart
+    OUTPUT_LATEST,     // every param us, output the latest event
+} OutputMode_t;
+
+typedef struct {
+    OutputMode_t mode;
+    uint32_t param;
+    uint32_t count;            // events since last output (OUTPUT_EVERY_NTH)
+    uint64_t last_us;          // event time of last output (OUTPUT_MAX_RATE)
+    uint32_t lastTimer_us;     // host time of last output (OUTPUT_LATEST)
+    bool held;                 // latest holds an event not yet output
+    sh2_SensorEvent_t latest;  // (OUTPUT_LATEST)
+    bool latestDecoded;        // latestValue holds latest, decoded
+    sh2_SensorValue_t latestValue;
+} OutputPolicy_t;
+
+// Sensor output formats
+typedef enum {
+    OUTPUT_TEXT,     // human readable text
+    OUTPUT_DSF,      // DSF records for logging
+    OUTPUT_BINARY,   // COBS framed binary records, see stream.h
+} OutputFormat_t;
 
 // --- Private data ---------------------------------------------------
 
+#if defined(DSF_OUTPUT)
+static OutputFormat_t outputFormat = OUTPUT_DSF;
+#elif defined(BINARY_OUTPUT)
+static OutputFormat_t outputFormat = OUTPUT_BINARY;
+#else
+static OutputFormat_t outputFormat = OUTPUT_TEXT;
+#endif
+
 sh2_ProductIds_t prodIds;
 
 sh2_Hal_t *pSh2Hal = 0;
 
 bool resetOccurred = false;
 
+// Output rate policy for each sensor
+static OutputPolicy_t outputPolicy[SH2_MAX_SENSOR_ID+1];
+static unsigned latestPolicies;  // number of sensors with OUTPUT_LATEST
+static bool textPolicyDefault;   // GIRV policy is the text format default
+
+// Sequence number accounting for each sensor
+static SequenceStats_t sequenceStats[SH2_MAX_SENSOR_ID+1];
+
+// Configuration replay after a sensor hub reset: enabled sensors in the
+// order they are configured, and the next to configure.
+static sh2_SensorId_t replayOrder[SH2_MAX_SENSOR_ID+1];
+static unsigned replayLen;
+static unsigned replayNext;
+
+// Reset recovery timing, from the last sensor hub reset.  Times are
+// microseconds after the reset, 0 if not reached yet.
+static uint64_t reset_us;
+static uint32_t configured_us[SH2_MAX_SENSOR_ID+1];
+static uint32_t firstSample_us[SH2_MAX_SENSOR_ID+1];
+
+// Startup reports waiting for the sensors to be configured
+static bool prodIdsPending;
+static bool bootTimelinePending;
+
+// Readers of the statistics below.  Each keeps its own snapshot, so the
+// stats command and the periodic report don't reset each other's counts.
+typedef enum {
+    STATS_COMMAND,
+    STATS_PERIODIC,
+    STATS_NUM_READERS
+} StatsReader_t;
+
+// Counts at a reader's last report
+typedef struct {
+    uint64_t time_us;
+    ConsoleStats_t console;
+    uint32_t events;
+    uint64_t eventCycles;
+    uint32_t serviceWakeups;
+    uint64_t serviceCycles;
+    uint32_t serviceEvents;
+} StatsSnapshot_t;
+
+static StatsSnapshot_t statsSnapshot[STATS_NUM_READERS];
+
+// Sensor event handling cost
+static uint32_t eventCount;
+static uint64_t eventCycles;
+static uint32_t eventMaxCycles[STATS_NUM_READERS];  // since each reader's last report
+
+// Sensor hub servicing cost: bursts of sh2_service calls that delivered
+// events (wakeups) and the CPU cycles they took, including event handling.
+static uint32_t serviceWakeups;
+static uint64_t serviceCycles;
+
+// Sensors enabled at startup.  (More can be enabled with console commands.)
+static const sh2_SensorId_t enabledSensors[] =
+{
+    SH2_GAME_ROTATION_VECTOR,
+    // SH2_RAW_ACCELEROMETER,
+    // SH2_RAW_GYROSCOPE,
+    // SH2_ROTATION_VECTOR,
+    // SH2_GYRO_INTEGRATED_RV,
+};
+
+// Sensor configurations, applied at startup and after each sensor hub reset.
+// Console commands change them at runtime.
+static sh2_SensorConfig_t sensorConfig[SH2_MAX_SENSOR_ID+1];
+static bool sensorEnabled[SH2_MAX_SENSOR_ID+1];
+
+// Sensor names accepted by console commands
+static const struct {
+    const char *name;
+    sh2_SensorId_t sensorId;
+} sensorNames[] = {
+    {"acc",     SH2_ACCELEROMETER},
+    {"gyro",    SH2_GYROSCOPE_CALIBRATED},
+    {"gyrou",   SH2_GYROSCOPE_UNCALIBRATED},
+    {"mag",     SH2_MAGNETIC_FIELD_CALIBRATED},
+    {"rawacc",  SH2_RAW_ACCELEROMETER},
+    {"rawgyro", SH2_RAW_GYROSCOPE},
+    {"rawmag",  SH2_RAW_MAGNETOMETER},
+    {"rv",      SH2_ROTATION_VECTOR},
+    {"grv",     SH2_GAME_ROTATION_VECTOR},
+    {"girv",    SH2_GYRO_INTEGRATED_RV},
+};
+
+// --- Forward declarations -------------------------------------------
+
+static void printDsfHeaders(void);
+static uint32_t extendSequence(sh2_SensorId_t sensorId, uint8_t sequence);
+
 // --- Private methods ----------------------------------------------
 
-// Configure one sensor to produce periodic reports
+// Set up default sensor configurations
+static void initSensorConfig(void)
+{
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        sh2_SensorConfig_t *pConfig = &sensorConfig[sensorId];
+        
+        // These sensor options are disabled or not used in most cases
+        pConfig->changeSensitivityEnabled = false;
+        pConfig->wakeupEnabled = false;
+        pConfig->changeSensitivityRelative = false;
+        pConfig->alwaysOnEnabled = false;
+        pConfig->changeSensitivity = 0;
+#ifdef BATCH_INTERVAL_US
+        pConfig->batchInterval_us = BATCH_INTERVAL_US;
+#else
+        pConfig->batchInterval_us = 0;
+#endif
+        pConfig->sensorSpecific = 0;
+
+        // Select a report interval.
+        pConfig->reportInterval_us = DEFAULT_INTERVAL_US;
+
+        sensorEnabled[sensorId] = false;
+    }
+
+    for (int n = 0; n < ARRAY_LEN(enabledSensors); n++) {
+        sensorEnabled[enabledSensors[n]] = true;
+    }
+}
+
+// Send one sensor's configuration to the sensor hub.
+// A disabled sensor is configured with a report interval of 0.
+static int applySensorConfig(sh2_SensorId_t sensorId)
+{
+    sh2_SensorConfig_t config = sensorConfig[sensorId];
+
+    if (!sensorEnabled[sensorId]) {
+        config.reportInterval_us = 0;
+    }
+    
+    return sh2_setSensorConfig(sensorId, &config);
+}
+
+// Start replaying the configurations of the enabled sensors after a
+// sensor hub reset.  Fastest sensors go first, as they lose the most
+// samples while waiting.  serviceReplay sends them.
 static void startReports()
 {
-    static sh2_SensorConfig_t config;
-    int status;
-    int sensorId;
-    static const int enabledSensors[] =
-    {
-        SH2_GAME_ROTATION_VECTOR,
-        // SH2_RAW_ACCELEROMETER,
-        // SH2_RAW_GYROSCOPE,
-        // SH2_ROTATION_VECTOR,
-        // SH2_GYRO_INTEGRATED_RV,
-    };
+    replayLen = 0;
+    replayNext = 0;
 
-    // These sensor options are disabled or not used in most cases
-    config.changeSensitivityEnabled = false;
-    config.wakeupEnabled = false;
-    config.changeSensitivityRelative = false;
-    config.alwaysOnEnabled = false;
-    config.changeSensitivity = 0;
-    config.batchInterval_us = 0;
-    config.sensorSpecific = 0;
-
-    // Select a report interval.
-    config.reportInterval_us = 10000;  // microseconds (100Hz)
-    // config.reportInterval_us = 2500;   // microseconds (400Hz)
-    // config.reportInterval_us = 1000;   // microseconds (1000Hz)
-
-    for (int n = 0; n < ARRAY_LEN(enabledSensors); n++)
-    {
-        // Configure the sensor hub to produce these reports
-        sensorId = enabledSensors[n];
-        status = sh2_setSensorConfig(sensorId, &config);
-        if (status != 0) {
-            printf("Error while enabling sensor %d\n", sensorId);
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        configured_us[sensorId] = 0;
+        firstSample_us[sensorId] = 0;
+        if (sensorEnabled[sensorId]) {
+            // Insert in order of report interval
+            unsigned n = replayLen++;
+            while ((n > 0) && (sensorConfig[replayOrder[n-1]].reportInterval_us >
+                               sensorConfig[sensorId].reportInterval_us)) {
+                replayOrder[n] = replayOrder[n-1];
+                n--;
+            }
+            replayOrder[n] = sensorId;
         }
     }
+}
+
+// Send the next configuration of a replay, if any.
+// One per call, so sensor reports from those already configured are
+// handled and output between them.
+static void serviceReplay(void)
+{
+    sh2_SensorId_t sensorId;
+    int status;
+    
+    if (replayNext >= replayLen) {
+        return;
+    }
     
+    sensorId = replayOrder[replayNext++];
+    status = applySensorConfig(sensorId);
+    if (status != SH2_OK) {
+        log_msg(LOG_ENABLE_ERROR, sensorId);
+    }
+    configured_us[sensorId] = (uint32_t)(timebase_nowUs() - reset_us);
+    boot_mark(BOOT_FIRST_CONFIG);
+}
+
+// Note the first sample of a sensor after a reset
+static void checkFirstSample(const sh2_SensorEvent_t *pEvent)
+{
+    sh2_SensorId_t sensorId = pEvent->reportId;
+
+    if ((sensorId <= SH2_MAX_SENSOR_ID) &&
+        (configured_us[sensorId] != 0) && (firstSample_us[sensorId] == 0)) {
+        firstSample_us[sensorId] = (uint32_t)(timebase_nowUs() - reset_us);
+        log_msg(LOG_FIRST_SAMPLE, sensorId, configured_us[sensorId], firstSample_us[sensorId]);
+    }
 }
 
 // Handle non-sensor events from the sensor hub
@@ -116,11 +355,18 @@ static void eventHandler(void * cookie, sh2_AsyncEvent_t *pEvent)
 {
     // If we see a reset, set a flag so that sensors will be reconfigured.
     if (pEvent->eventId == SH2_RESET) {
+        log_msg(LOG_HUB_RESET);
         resetOccurred = true;
+        reset_us = timebase_nowUs();
+
+        // Sequence numbers restart.  (Extended ones, the DSF SAMPLE_IDs,
+        // carry on from the last.)
+        for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+            sequenceStats[sensorId].started = false;
+        }
     }
 }
 
-#ifdef DSF_OUTPUT
 // Print headers for DSF format output
 static void printDsfHeaders(void)
 {
@@ -141,140 +387,107 @@ static void printDsfHeaders(void)
     printf("+%d TIME[x]{s}, ANG_VEL_GYRO_RV[xyz]{rad/s}, ANG_POS_GYRO_RV[wxyz]{quaternion}\n",
            SH2_GYRO_INTEGRATED_RV);
 }
-#endif
 
+// Append label then x, like printf "%s%0.6f"
+static char *putFloat(char *p, const char *label, float x)
+{
+    p = fmt_str(p, label);
+    return fmt_float(p, x, 0, 6);
+}
 
-#ifdef DSF_OUTPUT
-// Print a sensor event as a DSF record
-static void printDsf(const sh2_SensorEvent_t * event)
+// Append label then x, like printf "%s%d"
+static char *putInt(char *p, const char *label, int32_t x)
 {
-    float t, r, i, j, k, acc_rad;
-    float angVelX, angVelY, angVelZ;
-    static uint32_t lastSequence[SH2_MAX_SENSOR_ID+1];  // last sequence number for each sensor
-    sh2_SensorValue_t value;
+    p = fmt_str(p, label);
+    return fmt_int(p, x);
+}
 
-    // Convert event to value
-    sh2_decodeSensorEvent(&value, event);
-    
-    // Compute new sample_id
-    uint8_t deltaSeq = value.sequence - (lastSequence[value.sensorId] & 0xFF);
-    lastSequence[value.sensorId] += deltaSeq;
+// Terminate a line built at line and write it to stdout
+static void putLine(char *line, char *p)
+{
+    *p++ = '\n';
+    fwrite(line, 1, p - line, stdout);
+}
 
-    // Get time as float
-    t = value.timestamp / 1000000.0;
+// Print a sensor event as a DSF record
+static void printDsf(const sh2_SensorValue_t *pValue)
+{
+    char line[MAX_LINE_LEN];
+    char *p = line;
+
+    // Record starts with sensor id and time in seconds
+    p = putInt(p, ".", pValue->sensorId);
+    *p++ = ' ';
+    p = fmt_timeUs(p, pValue->timestamp, 0, 6);
+    if (pValue->sensorId != SH2_GYRO_INTEGRATED_RV) {
+        p = fmt_str(p, ", ");
+        p = fmt_uint(p, extendSequence(pValue->sensorId, pValue->sequence));
+    }
     
-    switch (value.sensorId) {
+    switch (pValue->sensorId) {
         case SH2_RAW_ACCELEROMETER:
-            printf(".%d %0.6f, %d, %d, %d, %d\n",
-                   SH2_RAW_ACCELEROMETER,
-                   t,
-                   lastSequence[value.sensorId],
-                   value.un.rawAccelerometer.x,
-                   value.un.rawAccelerometer.y,
-                   value.un.rawAccelerometer.z);
+            p = putInt(p, ", ", pValue->un.rawAccelerometer.x);
+            p = putInt(p, ", ", pValue->un.rawAccelerometer.y);
+            p = putInt(p, ", ", pValue->un.rawAccelerometer.z);
             break;
         
         case SH2_RAW_MAGNETOMETER:
-            printf(".%d %0.6f, %d, %d, %d, %d\n",
-                   SH2_RAW_MAGNETOMETER,
-                   t,
-                   lastSequence[value.sensorId],
-                   value.un.rawMagnetometer.x,
-                   value.un.rawMagnetometer.y,
-                   value.un.rawMagnetometer.z);
+            p = putInt(p, ", ", pValue->un.rawMagnetometer.x);
+            p = putInt(p, ", ", pValue->un.rawMagnetometer.y);
+            p = putInt(p, ", ", pValue->un.rawMagnetometer.z);
             break;
         
         case SH2_RAW_GYROSCOPE:
-            printf(".%d %0.6f, %d, %d, %d, %d\n",
-                   SH2_RAW_GYROSCOPE,
-                   t,
-                   lastSequence[value.sensorId],
-                   value.un.rawGyroscope.x,
-                   value.un.rawGyroscope.y,
-                   value.un.rawGyroscope.z);
+            p = putInt(p, ", ", pValue->un.rawGyroscope.x);
+            p = putInt(p, ", ", pValue->un.rawGyroscope.y);
+            p = putInt(p, ", ", pValue->un.rawGyroscope.z);
             break;
 
         case SH2_MAGNETIC_FIELD_CALIBRATED:
-            printf(".%d %0.6f, %d, %0.6f, %0.6f, %0.6f, %u\n",
-                   SH2_MAGNETIC_FIELD_CALIBRATED,
-                   t,
-                   lastSequence[value.sensorId],
-                   value.un.magneticField.x,
-                   value.un.magneticField.y,
-                   value.un.magneticField.z,
-                   value.status & 0x3
-                );
+            p = putFloat(p, ", ", pValue->un.magneticField.x);
+            p = putFloat(p, ", ", pValue->un.magneticField.y);
+            p = putFloat(p, ", ", pValue->un.magneticField.z);
+            p = putInt(p, ", ", pValue->status & 0x3);
             break;
         
         case SH2_ACCELEROMETER:
-            printf(".%d %0.6f, %d, %0.6f, %0.6f, %0.6f\n",
-                   SH2_ACCELEROMETER,
-                   t,
-                   lastSequence[value.sensorId],
-                   value.un.accelerometer.x,
-                   value.un.accelerometer.y,
-                   value.un.accelerometer.z);
+            p = putFloat(p, ", ", pValue->un.accelerometer.x);
+            p = putFloat(p, ", ", pValue->un.accelerometer.y);
+            p = putFloat(p, ", ", pValue->un.accelerometer.z);
             break;
         
         case SH2_ROTATION_VECTOR:
-            r = value.un.rotationVector.real;
-            i = value.un.rotationVector.i;
-            j = value.un.rotationVector.j;
-            k = value.un.rotationVector.k;
-            acc_rad = value.un.rotationVector.accuracy;
-            printf(".%d %0.6f, %d, %0.6f, %0.6f, %0.6f, %0.6f, %0.6f\n",
-                   SH2_ROTATION_VECTOR,
-                   t,
-                   lastSequence[value.sensorId],
-                   r, i, j, k,
-                   acc_rad);
+            p = putFloat(p, ", ", pValue->un.rotationVector.real);
+            p = putFloat(p, ", ", pValue->un.rotationVector.i);
+            p = putFloat(p, ", ", pValue->un.rotationVector.j);
+            p = putFloat(p, ", ", pValue->un.rotationVector.k);
+            p = putFloat(p, ", ", pValue->un.rotationVector.accuracy);
             break;
         
         case SH2_GAME_ROTATION_VECTOR:
-            r = value.un.gameRotationVector.real;
-            i = value.un.gameRotationVector.i;
-            j = value.un.gameRotationVector.j;
-            k = value.un.gameRotationVector.k;
-            printf(".%d %0.6f, %d, %0.6f, %0.6f, %0.6f, %0.6f\n",
-                   SH2_GAME_ROTATION_VECTOR,
-                   t,
-                   lastSequence[value.sensorId],
-                   r, i, j, k);
+            p = putFloat(p, ", ", pValue->un.gameRotationVector.real);
+            p = putFloat(p, ", ", pValue->un.gameRotationVector.i);
+            p = putFloat(p, ", ", pValue->un.gameRotationVector.j);
+            p = putFloat(p, ", ", pValue->un.gameRotationVector.k);
             break;
             
         case SH2_GYRO_INTEGRATED_RV:
-            angVelX = value.un.gyroIntegratedRV.angVelX;
-            angVelY = value.un.gyroIntegratedRV.angVelY;
-            angVelZ = value.un.gyroIntegratedRV.angVelZ;
-            r = value.un.gyroIntegratedRV.real;
-            i = value.un.gyroIntegratedRV.i;
-            j = value.un.gyroIntegratedRV.j;
-            k = value.un.gyroIntegratedRV.k;
-            printf(".%d %0.6f, %0.6f, %0.6f, %0.6f, %0.6f, %0.6f, %0.6f, %0.6f\n",
-                   SH2_GYRO_INTEGRATED_RV,
-                   t,
-                   angVelX, angVelY, angVelZ,
-                   r, i, j, k);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.angVelX);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.angVelY);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.angVelZ);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.real);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.i);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.j);
+            p = putFloat(p, ", ", pValue->un.gyroIntegratedRV.k);
             break;
         default:
-            printf("Unknown sensor: %d\n", value.sensorId);
-            break;
+            log_msg(LOG_UNKNOWN_SENSOR, pValue->sensorId);
+            return;
     }
-}
-#endif
 
-static void delayUs(uint32_t t)
-{
-    uint32_t now_us = pSh2Hal->getTimeUs(pSh2Hal);
-    uint32_t start_us = now_us;
-
-    while (t > (now_us - start_us))
-    {
-        now_us = pSh2Hal->getTimeUs(pSh2Hal);
-    }
+    putLine(line, p);
 }
 
-#ifndef DSF_OUTPUT
 // Read product ids with version info from sensor hub and print them
 static void reportProdIds(void)
 {
@@ -284,7 +497,7 @@ static void reportProdIds(void)
     status = sh2_getProdIds(&prodIds);
     
     if (status < 0) {
-        printf("Error from sh2_getProdIds.\n");
+        log_msg(LOG_PROD_IDS_ERROR);
         return;
     }
 
@@ -295,132 +508,1080 @@ static void reportProdIds(void)
                prodIds.entry[n].swVersionMajor, prodIds.entry[n].swVersionMinor, 
                prodIds.entry[n].swVersionPatch, prodIds.entry[n].swBuildNumber);
 
-        // Wait a bit so we don't overflow the console output.
-        delayUs(10000);
     }
 }
-#endif
 
-#ifndef DSF_OUTPUT
 // Print a sensor event to the console
-static void printEvent(const sh2_SensorEvent_t * event)
+static void printEvent(const sh2_SensorValue_t *pValue)
 {
-    int rc;
-    sh2_SensorValue_t value;
-    float scaleRadToDeg = 180.0 / 3.14159265358;
-    float r, i, j, k, acc_deg, x, y, z;
-    float t;
-    static int skip = 0;
-
-    rc = sh2_decodeSensorEvent(&value, event);
-    if (rc != SH2_OK) {
-        printf("Error decoding sensor event: %d\n", rc);
-        return;
-    }
+    char line[MAX_LINE_LEN];
+    char *p = line;
 
-    t = value.timestamp / 1000000.0;  // time in seconds.
-    switch (value.sensorId) {
+    // Time in seconds.
+    p = fmt_timeUs(p, pValue->timestamp, 8, 4);
+    switch (pValue->sensorId) {
         case SH2_RAW_ACCELEROMETER:
-            printf("%8.4f Raw acc: %d %d %d\n",
-                   t,
-                   value.un.rawAccelerometer.x,
-                   value.un.rawAccelerometer.y,
-                   value.un.rawAccelerometer.z);
+            p = putInt(p, " Raw acc: ", pValue->un.rawAccelerometer.x);
+            p = putInt(p, " ", pValue->un.rawAccelerometer.y);
+            p = putInt(p, " ", pValue->un.rawAccelerometer.z);
             break;
 
         case SH2_ACCELEROMETER:
-            printf("%8.4f Acc: %f %f %f\n",
-                   t,
-                   value.un.accelerometer.x,
-                   value.un.accelerometer.y,
-                   value.un.accelerometer.z);
+            p = putFloat(p, " Acc: ", pValue->un.accelerometer.x);
+            p = putFloat(p, " ", pValue->un.accelerometer.y);
+            p = putFloat(p, " ", pValue->un.accelerometer.z);
             break;
             
         case SH2_RAW_GYROSCOPE:
-            printf("%8.4f Raw gyro: x:%d y:%d z:%d temp:%d time_us:%d\n",
-                   t,
-                   value.un.rawGyroscope.x,
-                   value.un.rawGyroscope.y,
-                   value.un.rawGyroscope.z,
-                   value.un.rawGyroscope.temperature,
-                   value.un.rawGyroscope.timestamp);
+            p = putInt(p, " Raw gyro: x:", pValue->un.rawGyroscope.x);
+            p = putInt(p, " y:", pValue->un.rawGyroscope.y);
+            p = putInt(p, " z:", pValue->un.rawGyroscope.z);
+            p = putInt(p, " temp:", pValue->un.rawGyroscope.temperature);
+            p = putInt(p, " time_us:", pValue->un.rawGyroscope.timestamp);
             break;
             
         case SH2_ROTATION_VECTOR:
-            r = value.un.rotationVector.real;
-            i = value.un.rotationVector.i;
-            j = value.un.rotationVector.j;
-            k = value.un.rotationVector.k;
-            acc_deg = scaleRadToDeg * 
-                value.un.rotationVector.accuracy;
-            printf("%8.4f Rotation Vector: "
-                   "r:%0.6f i:%0.6f j:%0.6f k:%0.6f (acc: %0.6f deg)\n",
-                   t,
-                   r, i, j, k, acc_deg);
+            p = putFloat(p, " Rotation Vector: r:", pValue->un.rotationVector.real);
+            p = putFloat(p, " i:", pValue->un.rotationVector.i);
+            p = putFloat(p, " j:", pValue->un.rotationVector.j);
+            p = putFloat(p, " k:", pValue->un.rotationVector.k);
+            p = putFloat(p, " (acc: ", scaleRadToDeg * pValue->un.rotationVector.accuracy);
+            p = fmt_str(p, " deg)");
             break;
         case SH2_GAME_ROTATION_VECTOR:
-            r = value.un.gameRotationVector.real;
-            i = value.un.gameRotationVector.i;
-            j = value.un.gameRotationVector.j;
-            k = value.un.gameRotationVector.k;
-            printf("%8.4f GRV: "
-                   "r:%0.6f i:%0.6f j:%0.6f k:%0.6f\n",
-                   t,
-                   r, i, j, k);
+            p = putFloat(p, " GRV: r:", pValue->un.gameRotationVector.real);
+            p = putFloat(p, " i:", pValue->un.gameRotationVector.i);
+            p = putFloat(p, " j:", pValue->un.gameRotationVector.j);
+            p = putFloat(p, " k:", pValue->un.gameRotationVector.k);
             break;
         case SH2_GYROSCOPE_CALIBRATED:
-            x = value.un.gyroscope.x;
-            y = value.un.gyroscope.y;
-            z = value.un.gyroscope.z;
-            printf("%8.4f GYRO: "
-                   "x:%0.6f y:%0.6f z:%0.6f\n",
-                   t,
-                   x, y, z);
+            p = putFloat(p, " GYRO: x:", pValue->un.gyroscope.x);
+            p = putFloat(p, " y:", pValue->un.gyroscope.y);
+            p = putFloat(p, " z:", pValue->un.gyroscope.z);
             break;
         case SH2_GYROSCOPE_UNCALIBRATED:
-            x = value.un.gyroscopeUncal.x;
-            y = value.un.gyroscopeUncal.y;
-            z = value.un.gyroscopeUncal.z;
-            printf("%8.4f GYRO_UNCAL: "
-                   "x:%0.6f y:%0.6f z:%0.6f\n",
-                   t,
-                   x, y, z);
+            p = putFloat(p, " GYRO_UNCAL: x:", pValue->un.gyroscopeUncal.x);
+            p = putFloat(p, " y:", pValue->un.gyroscopeUncal.y);
+            p = putFloat(p, " z:", pValue->un.gyroscopeUncal.z);
             break;
         case SH2_GYRO_INTEGRATED_RV:
-            // These come at 1kHz, too fast to print all of them.
-            // So only print every 10th one
-            skip++;
-            if (skip == 10) {
-                skip = 0;
-                r = value.un.gyroIntegratedRV.real;
-                i = value.un.gyroIntegratedRV.i;
-                j = value.un.gyroIntegratedRV.j;
-                k = value.un.gyroIntegratedRV.k;
-                x = value.un.gyroIntegratedRV.angVelX;
-                y = value.un.gyroIntegratedRV.angVelY;
-                z = value.un.gyroIntegratedRV.angVelZ;
-                printf("%8.4f Gyro Integrated RV: "
-                       "r:%0.6f i:%0.6f j:%0.6f k:%0.6f x:%0.6f y:%0.6f z:%0.6f\n",
-                       t,
-                       r, i, j, k,
-                       x, y, z);
-            }
+            p = putFloat(p, " Gyro Integrated RV: r:", pValue->un.gyroIntegratedRV.real);
+            p = putFloat(p, " i:", pValue->un.gyroIntegratedRV.i);
+            p = putFloat(p, " j:", pValue->un.gyroIntegratedRV.j);
+            p = putFloat(p, " k:", pValue->un.gyroIntegratedRV.k);
+            p = putFloat(p, " x:", pValue->un.gyroIntegratedRV.angVelX);
+            p = putFloat(p, " y:", pValue->un.gyroIntegratedRV.angVelY);
+            p = putFloat(p, " z:", pValue->un.gyroIntegratedRV.angVelZ);
             break;
         default:
-            printf("Unknown sensor: %d\n", value.sensorId);
-            break;
+            log_msg(LOG_UNKNOWN_SENSOR, pValue->sensorId);
+            return;
     }
+
+    putLine(line, p);
+}
+
+#ifdef FORMAT_BENCHMARK
+// Format a typical rotation vector line with printf and with fmt,
+// and print the CPU cycles per line for each.
+static void benchmarkFormat(void)
+{
+    const unsigned count = 100;
+    const uint64_t t_us = 123456789;
+    const float q[4] = {0.707107f, -0.001234f, 0.5f, -0.499999f};
+    char line[MAX_LINE_LEN];
+    char *p;
+    uint32_t start;
+    uint32_t printfCycles;
+    uint32_t fmtCycles;
+
+    start = dbg_cycles();
+    for (unsigned n = 0; n < count; n++) {
+        snprintf(line, sizeof(line), "%8.4f Rotation Vector: "
+                 "r:%0.6f i:%0.6f j:%0.6f k:%0.6f (acc: %0.6f deg)",
+                 (double)(t_us / 1000000.0f),
+                 (double)q[0], (double)q[1], (double)q[2], (double)q[3], (double)q[0]);
+    }
+    printfCycles = (dbg_cycles() - start) / count;
+
+    start = dbg_cycles();
+    for (unsigned n = 0; n < count; n++) {
+        p = fmt_timeUs(line, t_us, 8, 4);
+        p = putFloat(p, " Rotation Vector: r:", q[0]);
+        p = putFloat(p, " i:", q[1]);
+        p = putFloat(p, " j:", q[2]);
+        p = putFloat(p, " k:", q[3]);
+        p = putFloat(p, " (acc: ", q[0]);
+        p = fmt_str(p, " deg)");
+        *p = 0;
+    }
+    fmtCycles = (dbg_cycles() - start) / count;
+
+    printf("Format cycles/line: printf %u, fmt %u\n", printfCycles, fmtCycles);
 }
 #endif
 
+#ifdef ORIENTATION_BENCHMARK
+// Compare the orientation kernels with the reference conversions: cycles
+// per sample and the largest difference in any output.
+static void benchmarkOrientation(void)
+{
+    enum { COUNT = 64 };
+    static float q[4][COUNT];
+    static float m[9][COUNT];
+    static float euler[3][COUNT];
+    const float *pQ[4] = {q[0], q[1], q[2], q[3]};
+    float *pM[9];
+    uint32_t seed = 12345;
+    uint32_t start;
+    uint32_t kernelCycles[2];
+    uint32_t refCycles[2];
+    float maxError[2] = {0.0f, 0.0f};
+    char line[MAX_LINE_LEN];
+    char *p;
+
+    // Pseudo-random unit quaternions
+    for (int n = 0; n < COUNT; n++) {
+        float norm = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            seed = seed * 1664525 + 1013904223;
+            q[c][n] = (float)(int32_t)seed / 2147483648.0f;
+            norm += q[c][n] * q[c][n];
+        }
+        norm = 1.0f / sqrtf(norm);
+        for (int c = 0; c < 4; c++) {
+            q[c][n] *= norm;
+        }
+    }
+    for (int k = 0; k < 9; k++) {
+        pM[k] = m[k];
+    }
+
+    start = dbg_cycles();
+    orient_quatToMatrix(pQ, pM, COUNT);
+    kernelCycles[0] = (dbg_cycles() - start) / COUNT;
+    start = dbg_cycles();
+    orient_quatToEuler(pQ, euler[0], euler[1], euler[2], COUNT);
+    kernelCycles[1] = (dbg_cycles() - start) / COUNT;
+
+    refCycles[0] = 0;
+    refCycles[1] = 0;
+    for (int n = 0; n < COUNT; n++) {
+        float qn[4] = {q[0][n], q[1][n], q[2][n], q[3][n]};
+        float ref[9];
+
+        start = dbg_cycles();
+        orient_refQuatToMatrix(qn, ref);
+        refCycles[0] += dbg_cycles() - start;
+        for (int k = 0; k < 9; k++) {
+            maxError[0] = fmaxf(maxError[0], fabsf(ref[k] - m[k][n]));
+        }
+
+        start = dbg_cycles();
+        orient_refQuatToEuler(qn, &ref[0], &ref[1], &ref[2]);
+        refCycles[1] += dbg_cycles() - start;
+        for (int k = 0; k < 3; k++) {
+            maxError[1] = fmaxf(maxError[1], fabsf(ref[k] - euler[k][n]));
+        }
+    }
+
+    printf("Orientation cycles/sample: matrix %u (ref %u), euler %u (ref %u)\n",
+           kernelCycles[0], refCycles[0] / COUNT, kernelCycles[1], refCycles[1] / COUNT);
+    p = putFloat(line, "Orientation max error: matrix ", maxError[0]);
+    p = putFloat(p, ", euler ", maxError[1]);
+    putLine(line, p);
+}
+#endif
+
+// Print the predicted orientation from the latest rotation vector sample
+static void printPrediction(void)
+{
+    char line[2 + 5 * (FMT_NUM_MAX + 1) + 1];
+    uint64_t t_us;
+    float q[4];
+    char *p;
+
+    if (!predict_latest(&t_us, q)) {
+        return;
+    }
+
+    p = fmt_str(line, "P ");
+    p = fmt_timeUs(p, t_us, 0, 6);
+    for (int n = 0; n < 4; n++) {
+        p = putFloat(p, " ", q[n]);
+    }
+    putLine(line, p);
+}
+
+// Output a sensor event in the current format.
+// pValue is the event already decoded, or 0 if it has not been.
+static void outputEvent(const sh2_SensorEvent_t *pEvent, const sh2_SensorValue_t *pValue)
+{
+    sh2_SensorValue_t value;
+    int rc;
+
+    if (outputFormat == OUTPUT_BINARY) {
+        // Sent raw, the host decodes it
+        stream_sendEvent(pEvent);
+        return;
+    }
+
+    if (pValue == 0) {
+        rc = sh2_decodeSensorEvent(&value, pEvent);
+        if (rc != SH2_OK) {
+            log_msg(LOG_DECODE_ERROR, rc);
+            return;
+        }
+        pValue = &value;
+    }
+
+    if (outputFormat == OUTPUT_DSF) {
+        printDsf(pValue);
+    }
+    else {
+        printEvent(pValue);
+    }
+
+    // Follow a predicted rotation vector with its prediction
+    if (predict_isActive(pEvent->reportId)) {
+        printPrediction();
+    }
+}
+
+// Apply a sensor's output policy to an event, without decoding it.
+// pValue is the event already decoded, or 0 if it has not been.
+// Returns true if the event should be output now.
+static bool outputWanted(const sh2_SensorEvent_t *pEvent, const sh2_SensorValue_t *pValue)
+{
+    OutputPolicy_t *pPolicy;
+
+    if (pEvent->reportId > SH2_MAX_SENSOR_ID) {
+        // Not a sensor we track, let the output stage report it
+        return true;
+    }
+    pPolicy = &outputPolicy[pEvent->reportId];
+    
+    switch (pPolicy->mode) {
+        case OUTPUT_EVERY_NTH:
+            pPolicy->count++;
+            if (pPolicy->count < pPolicy->param) {
+                return false;
+            }
+            pPolicy->count = 0;
+            return true;
+        case OUTPUT_MAX_RATE:
+            if ((pEvent->timestamp_uS - pPolicy->last_us) < pPolicy->param) {
+                return false;
+            }
+            pPolicy->last_us = pEvent->timestamp_uS;
+            return true;
+        case OUTPUT_LATEST:
+            // Output later by serviceLatest, with its value if decoded
+            pPolicy->latest = *pEvent;
+            pPolicy->latestDecoded = (pValue != 0);
+            if (pValue != 0) {
+                pPolicy->latestValue = *pValue;
+            }
+            pPolicy->held = true;
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Output held events for sensors with OUTPUT_LATEST whose timer has expired
+static void serviceLatest(void)
+{
+    uint32_t now_us;
+
+    if (latestPolicies == 0) {
+        return;
+    }
+
+    now_us = pSh2Hal->getTimeUs(pSh2Hal);
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        OutputPolicy_t *pPolicy = &outputPolicy[sensorId];
+        if ((pPolicy->mode == OUTPUT_LATEST) && pPolicy->held &&
+            ((now_us - pPolicy->lastTimer_us) >= pPolicy->param)) {
+            pPolicy->lastTimer_us = now_us;
+            pPolicy->held = false;
+            outputEvent(&pPolicy->latest,
+                        pPolicy->latestDecoded ? &pPolicy->latestValue : 0);
+        }
+    }
+}
+
+// Set the output policy for a sensor
+static void setOutputPolicy(sh2_SensorId_t sensorId, OutputMode_t mode, uint32_t param)
+{
+    OutputPolicy_t *pPolicy = &outputPolicy[sensorId];
+
+    if (pPolicy->mode == OUTPUT_LATEST) {
+        latestPolicies--;
+    }
+    if (mode == OUTPUT_LATEST) {
+        latestPolicies++;
+    }
+    
+    pPolicy->mode = mode;
+    pPolicy->param = param;
+    pPolicy->count = 0;
+    pPolicy->last_us = 0;
+    pPolicy->held = false;
+
+    if (sensorId == SH2_GYRO_INTEGRATED_RV) {
+        textPolicyDefault = false;
+    }
+}
+
+// Apply or remove the default output policies of text format.
+// Policies set by command are left alone.
+static void setTextPolicies(bool text)
+{
+    if (text && (outputPolicy[SH2_GYRO_INTEGRATED_RV].mode == OUTPUT_ALL)) {
+        // Gyro integrated RV comes at 1kHz, too fast to print all of them.
+        // So only print every 10th one.
+        setOutputPolicy(SH2_GYRO_INTEGRATED_RV, OUTPUT_EVERY_NTH, 10);
+        textPolicyDefault = true;
+    }
+    else if (!text && textPolicyDefault) {
+        // DSF and binary records keep up with every one
+        setOutputPolicy(SH2_GYRO_INTEGRATED_RV, OUTPUT_ALL, 0);
+    }
+}
+
+// Extend an 8-bit sequence number of a recent event to the sensor's
+// 32-bit sequence.  (The event may be older than the last one accounted.)
+static uint32_t extendSequence(sh2_SensorId_t sensorId, uint8_t sequence)
+{
+    return sequence_extend(&sequenceStats[sensorId], sequence);
+}
+
+// Account for an event's sequence number, without decoding it.
+static void checkSequence(const sh2_SensorEvent_t *pEvent)
+{
+    // Gyro integrated RV reports carry no sequence number
+    if ((pEvent->reportId > SH2_MAX_SENSOR_ID) ||
+        (pEvent->reportId == SH2_GYRO_INTEGRATED_RV) ||
+        (pEvent->len < 2)) {
+        return;
+    }
+
+    // Report byte 1 is the sequence number
+    sequence_check(&sequenceStats[pEvent->reportId], pEvent->report[1]);
+}
+
 // Handle sensor events.
 static void sensorHandler(void * cookie, sh2_SensorEvent_t *pEvent)
 {
-#ifdef DSF_OUTPUT
-    printDsf(pEvent);
-#else
-    printEvent(pEvent);
+    uint32_t start = dbg_cycles();
+    uint32_t cycles;
+    sh2_SensorValue_t value;
+    const sh2_SensorValue_t *pValue = 0;
+    int rc = SH2_OK;
+
+    boot_mark(BOOT_FIRST_SAMPLE);
+    checkSequence(pEvent);
+    checkFirstSample(pEvent);
+
+    // Keep history of tracked sensors, whether output or not.  The value
+    // decoded here is passed on, so output doesn't decode it again.
+    if (samples_isTracked(pEvent->reportId)) {
+        rc = sh2_decodeSensorEvent(&value, pEvent);
+        if (rc == SH2_OK) {
+            samples_add(&value);
+            pValue = &value;
+        }
+        else {
+            log_msg(LOG_DECODE_ERROR, rc);
+        }
+    }
+
+    if (outputWanted(pEvent, pValue) && (rc == SH2_OK)) {
+        outputEvent(pEvent, pValue);
+    }
+
+    cycles = dbg_cycles() - start;
+    eventCount++;
+    eventCycles += cycles;
+    for (unsigned reader = 0; reader < STATS_NUM_READERS; reader++) {
+        if (cycles > eventMaxCycles[reader]) {
+            eventMaxCycles[reader] = cycles;
+        }
+    }
+}
+
+// Print console interrupts and CPU cycles per line since the reader's last
+// report, and any output dropped because the console could not keep up.
+static void printConsoleStats(StatsReader_t reader)
+{
+    ConsoleStats_t *pLast = &statsSnapshot[reader].console;
+    ConsoleStats_t stats;
+    uint32_t lines;
+
+    console_getStats(&stats);
+    lines = stats.lines - pLast->lines;
+    if (lines > 0) {
+        printf("Console: %u lines, %u irqs/line, %u cycles/line, "
+               "dropped %u lines %u records %u bytes\n",
+               lines,
+               (stats.irqs - pLast->irqs) / lines,
+               (stats.txCycles - pLast->txCycles) / lines,
+               stats.droppedLines - pLast->droppedLines,
+               stats.droppedRecords - pLast->droppedRecords,
+               stats.droppedBytes - pLast->droppedBytes);
+    }
+    *pLast = stats;
+}
+
+// Print sensor events handled and CPU cycles per event since the reader's
+// last report
+static void printEventStats(StatsReader_t reader)
+{
+    StatsSnapshot_t *pLast = &statsSnapshot[reader];
+    uint32_t count = eventCount - pLast->events;
+
+    if (count > 0) {
+        printf("Events: %u, %u cycles/event, max %u\n",
+               count, (uint32_t)((eventCycles - pLast->eventCycles) / count),
+               eventMaxCycles[reader]);
+    }
+    pLast->events = eventCount;
+    pLast->eventCycles = eventCycles;
+    eventMaxCycles[reader] = 0;
+}
+
+// Print sensor hub wakeups and the CPU load of servicing them since the
+// reader's last report.  Compare batched and unbatched modes with this.
+static void printServiceStats(StatsReader_t reader)
+{
+    StatsSnapshot_t *pLast = &statsSnapshot[reader];
+    uint64_t now_us = timebase_nowUs();
+    uint64_t elapsed_us = now_us - pLast->time_us;
+    uint32_t wakeups = serviceWakeups - pLast->serviceWakeups;
+    uint32_t events = eventCount - pLast->serviceEvents;
+    uint64_t cycles = serviceCycles - pLast->serviceCycles;
+    uint64_t elapsedCycles = elapsed_us * (SystemCoreClock / 1000000);
+
+    if ((wakeups > 0) && (elapsedCycles > 0)) {
+        uint32_t load = (uint32_t)((cycles * 1000) / elapsedCycles);
+        printf("Sensor hub: %u wakeups/s, %u events/wakeup, CPU load %u.%u%%\n",
+               (uint32_t)(((uint64_t)wakeups * 1000000) / elapsed_us),
+               events / wakeups,
+               load / 10, load % 10);
+    }
+    pLast->time_us = now_us;
+    pLast->serviceWakeups = serviceWakeups;
+    pLast->serviceCycles = serviceCycles;
+    pLast->serviceEvents = eventCount;
+}
+
+// Print grid points the fused output skipped because an input stalled
+static void printFusedStats(void)
+{
+    uint32_t skipped = resample_skipped();
+
+    if (skipped > 0) {
+        printf("Fused: %u grid points skipped\n", skipped);
+    }
+}
+
+// Print the time each boot phase was reached and its duration
+static void printBootTimeline(void)
+{
+    uint32_t last_us = 0;
+
+    for (int phase = 0; phase < BOOT_NUM_PHASES; phase++) {
+        uint32_t t_us;
+        if (boot_time((BootPhase_t)phase, &t_us)) {
+            printf("Boot: %-14s at %8u us (+%u)\n",
+                   boot_phaseName((BootPhase_t)phase), t_us, t_us - last_us);
+            last_us = t_us;
+        }
+    }
+}
+
+// Print the timing of recovery from the last sensor hub reset
+static void printResetStats(void)
+{
+    for (unsigned n = 0; n < replayLen; n++) {
+        sh2_SensorId_t sensorId = replayOrder[n];
+        printf("Sensor %d: configured %u us, first sample %u us after reset\n",
+               sensorId, configured_us[sensorId], firstSample_us[sensorId]);
+    }
+}
+
+// Print sequence accounting for sensors that have received events
+static void printSequenceStats(void)
+{
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        const SequenceStats_t *pStats = &sequenceStats[sensorId];
+        if (pStats->received > 0) {
+            printf("Sensor %d: received %u, lost %u, duplicate %u, late %u\n",
+                   sensorId, pStats->received, pStats->lost,
+                   pStats->duplicate, pStats->late);
+        }
+    }
+}
+
+// Every SEQUENCE_STATS_INTERVAL_US, log sensors that lost, repeated or
+// reordered samples since the last check.
+static void reportSequenceStats(void)
+{
+    static uint32_t lastReport_us = 0;
+    static SequenceStats_t last[SH2_MAX_SENSOR_ID+1];
+    uint32_t now_us = pSh2Hal->getTimeUs(pSh2Hal);
+
+    if ((now_us - lastReport_us) < SEQUENCE_STATS_INTERVAL_US) {
+        return;
+    }
+    lastReport_us = now_us;
+
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        const SequenceStats_t *pStats = &sequenceStats[sensorId];
+        uint32_t lost = pStats->lost - last[sensorId].lost;
+        uint32_t duplicate = pStats->duplicate - last[sensorId].duplicate;
+        uint32_t late = pStats->late - last[sensorId].late;
+        if ((lost != 0) || (duplicate != 0) || (late != 0)) {
+            log_msg(LOG_SAMPLES_LOST, sensorId, lost, duplicate, late);
+        }
+        last[sensorId] = *pStats;
+    }
+}
+
+#ifdef CONSOLE_STATS
+// Print console and event statistics every CONSOLE_STATS_INTERVAL_US
+static void reportConsoleStats(void)
+{
+    static uint32_t lastReport_us = 0;
+    uint32_t now_us = pSh2Hal->getTimeUs(pSh2Hal);
+
+    if ((now_us - lastReport_us) < CONSOLE_STATS_INTERVAL_US) {
+        return;
+    }
+    lastReport_us = now_us;
+
+    printConsoleStats(STATS_PERIODIC);
+    printEventStats(STATS_PERIODIC);
+    printServiceStats(STATS_PERIODIC);
+}
 #endif
+
+// Parse a sensor name or number.  Returns -1 if not valid.
+static int parseSensor(const char *s)
+{
+    char *end;
+    unsigned long sensorId;
+    
+    for (int n = 0; n < ARRAY_LEN(sensorNames); n++) {
+        if (strcmp(s, sensorNames[n].name) == 0) {
+            return sensorNames[n].sensorId;
+        }
+    }
+
+    sensorId = strtoul(s, &end, 0);
+    if ((end == s) || (*end != 0) || (sensorId == 0) || (sensorId > SH2_MAX_SENSOR_ID)) {
+        return -1;
+    }
+
+    return (int)sensorId;
+}
+
+// Parse an unsigned number.  Returns false if not valid.
+static bool parseUint(const char *s, uint32_t *pValue)
+{
+    char *end;
+
+    *pValue = strtoul(s, &end, 0);
+    return (end != s) && (*end == 0);
+}
+
+// Print the configuration of enabled sensors
+static void printSensorConfig(void)
+{
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        if (sensorEnabled[sensorId]) {
+            const sh2_SensorConfig_t *pConfig = &sensorConfig[sensorId];
+            const OutputPolicy_t *pPolicy = &outputPolicy[sensorId];
+            static const char *modeNames[] = {"all", "every", "max", "latest"};
+            printf("Sensor %d: interval %u us, batch %u us, sensitivity %u%s, output %s %u\n",
+                   sensorId,
+                   pConfig->reportInterval_us,
+                   pConfig->batchInterval_us,
+                   pConfig->changeSensitivityEnabled ? pConfig->changeSensitivity : 0,
+                   pConfig->changeSensitivityRelative ? " rel" : "",
+                   modeNames[pPolicy->mode], pPolicy->param);
+        }
+    }
+}
+
+// Print the last n samples kept for a sensor, oldest first
+static void printHistory(sh2_SensorId_t sensorId, unsigned n)
+{
+    SampleSlice_t slice;
+    char line[(1 + SAMPLES_MAX_COMPONENTS) * (FMT_NUM_MAX + 1) + 1];
+    
+    if (!samples_isTracked(sensorId)) {
+        printf("Sensor %d is not tracked.\n", sensorId);
+        return;
+    }
+    
+    samples_last(sensorId, n, &slice);
+    for (unsigned span = 0; span < 2; span++) {
+        for (unsigned i = 0; i < slice.count[span]; i++) {
+            char *p = fmt_timeUs(line, slice.pTimestamp_us[span][i], 0, 6);
+            for (unsigned c = 0; c < slice.numComponents; c++) {
+                p = putFloat(p, " ", slice.pValue[c][span][i]);
+            }
+            putLine(line, p);
+        }
+    }
+}
+
+// Start predicting a rotation vector, with angular velocity from the gyro
+// integrated RV or else the calibrated gyroscope, enabling it if needed.
+static void startPrediction(sh2_SensorId_t sensorId, uint32_t horizon_ms)
+{
+    sh2_SensorId_t gyroId = SH2_GYROSCOPE_CALIBRATED;
+    int status;
+
+    if ((sensorId != SH2_ROTATION_VECTOR) && (sensorId != SH2_GAME_ROTATION_VECTOR) &&
+        (sensorId != SH2_GEOMAGNETIC_ROTATION_VECTOR) && (sensorId != SH2_GYRO_INTEGRATED_RV)) {
+        printf("Sensor %d is not a rotation vector.\n", sensorId);
+        return;
+    }
+    if ((sensorId == SH2_GYRO_INTEGRATED_RV) || sensorEnabled[SH2_GYRO_INTEGRATED_RV]) {
+        gyroId = SH2_GYRO_INTEGRATED_RV;
+    }
+
+    if (!predict_start(sensorId, gyroId, horizon_ms * 1000)) {
+        printf("Too many sensors tracked.\n");
+        return;
+    }
+    if (!sensorEnabled[gyroId]) {
+        sensorEnabled[gyroId] = true;
+        status = applySensorConfig(gyroId);
+        if (status != SH2_OK) {
+            printf("Error %d configuring sensor %d\n", status, gyroId);
+        }
+    }
+}
+
+// Print prediction accuracy and cost over the samples kept
+static void printPredictionStats(void)
+{
+    PredictStats_t stats;
+    char line[100 + 5 * FMT_NUM_MAX];
+    char *p;
+
+    if (!predict_evaluate(&stats)) {
+        printf("Not enough samples to check prediction.\n");
+        return;
+    }
+
+    p = putInt(line, "Prediction: ", stats.count);
+    p = putFloat(p, " samples, error mean ", stats.meanError * scaleRadToDeg);
+    p = putFloat(p, " max ", stats.maxError * scaleRadToDeg);
+    p = putFloat(p, " deg, unpredicted mean ", stats.meanHoldError * scaleRadToDeg);
+    p = putInt(p, " deg, cycles ", stats.cycles);
+    putLine(line, p);
+}
+
+// Print Euler angles of the last n samples kept for a rotation vector,
+// oldest first
+static void printEuler(sh2_SensorId_t sensorId, unsigned n)
+{
+    SampleSlice_t slice;
+    float angles[3][SAMPLES_DEPTH];
+    char line[4 * (FMT_NUM_MAX + 1) + 1];
+    unsigned i = 0;
+
+    if ((sensorId != SH2_ROTATION_VECTOR) && (sensorId != SH2_GAME_ROTATION_VECTOR) &&
+        (sensorId != SH2_GEOMAGNETIC_ROTATION_VECTOR) && (sensorId != SH2_GYRO_INTEGRATED_RV)) {
+        printf("Sensor %d is not a rotation vector.\n", sensorId);
+        return;
+    }
+    if (!samples_isTracked(sensorId)) {
+        printf("Sensor %d is not tracked.\n", sensorId);
+        return;
+    }
+
+    // Convert each span of the slice in one batch
+    samples_last(sensorId, n, &slice);
+    for (unsigned span = 0; span < 2; span++) {
+        const float *pQ[4] = {
+            slice.pValue[0][span], slice.pValue[1][span],
+            slice.pValue[2][span], slice.pValue[3][span],
+        };
+        orient_quatToEuler(pQ, &angles[0][i], &angles[1][i], &angles[2][i], slice.count[span]);
+        i += slice.count[span];
+    }
+
+    i = 0;
+    for (unsigned span = 0; span < 2; span++) {
+        for (unsigned k = 0; k < slice.count[span]; k++, i++) {
+            char *p = fmt_timeUs(line, slice.pTimestamp_us[span][k], 0, 6);
+            p = putFloat(p, " yaw ", angles[0][i] * scaleRadToDeg);
+            p = putFloat(p, " pitch ", angles[1][i] * scaleRadToDeg);
+            p = putFloat(p, " roll ", angles[2][i] * scaleRadToDeg);
+            putLine(line, p);
+        }
+    }
+}
+
+static void printHelp(void)
+{
+    printf("Commands:\n");
+    printf("  on <sensor>               enable sensor\n");
+    printf("  off <sensor>              disable sensor\n");
+    printf("  rate <sensor> <hz>        set report rate\n");
+    printf("  batch <sensor> <us>       set batch interval (0 for no batching)\n");
+    printf("  batch all <us>            set batch interval of all sensors\n");
+    printf("  sens <sensor> <n> [rel]   set change sensitivity (0 to disable)\n");
+    printf("  out <sensor> all          output every event\n");
+    printf("  out <sensor> every <n>    output one event in n\n");
+    printf("  out <sensor> max <hz>     output at most hz events/s\n");
+    printf("  out <sensor> latest <hz>  output the latest event hz times/s\n");
+    printf("  fuse <hz>|off             output acc, gyro and grv resampled to a\n");
+    printf("                            common time grid (F records)\n");
+    printf("  predict <sensor> <ms>     follow rotation vector output with its\n");
+    printf("                            prediction ms ahead (P records)\n");
+    printf("  predict check|off         check prediction on samples kept, or stop\n");
+    printf("  format text|dsf|binary    select output format\n");
+    printf("  baud <rate>               change console baud rate, confirm with\n");
+    printf("                            \"%s\" at the new rate within %u ms\n",
+           CONSOLE_BAUD_CONFIRM, BAUD_CONFIRM_MS);
+    printf("  baud auto                 try rates fastest first, %u ms each,\n", BAUD_AUTO_STEP_MS);
+    printf("                            until one is confirmed\n");
+    printf("  track <sensor>            keep the last %u samples of sensor\n", SAMPLES_DEPTH);
+    printf("  untrack <sensor>          stop keeping samples of sensor\n");
+    printf("  hist <sensor> <n>         print the last n samples kept\n");
+    printf("  euler <sensor> <n>        print the last n rotation vector samples\n");
+    printf("                            kept as yaw, pitch, roll (degrees)\n");
+    printf("  show                      list enabled sensors\n");
+    printf("  stats                     print console, event, sensor hub, fused,\n");
+    printf("                            sequence, reset recovery and boot statistics\n");
+    printf("Sensors are numbers or names:");
+    for (int n = 0; n < ARRAY_LEN(sensorNames); n++) {
+        printf(" %s", sensorNames[n].name);
+    }
+    printf("\n");
+}
+
+// Set the batch interval of all sensors, reconfiguring those enabled
+static void setBatchInterval(uint32_t interval_us)
+{
+    int status;
+    
+    for (int sensorId = 0; sensorId <= SH2_MAX_SENSOR_ID; sensorId++) {
+        sensorConfig[sensorId].batchInterval_us = interval_us;
+        if (sensorEnabled[sensorId]) {
+            status = applySensorConfig(sensorId);
+            if (status != SH2_OK) {
+                printf("Error %d configuring sensor %d\n", status, sensorId);
+            }
+        }
+    }
+}
+
+// Print a fused record from the resampling stage
+static void printFused(void *cookie, const ResampleRecord_t *pRecord)
+{
+    char line[2 + (1 + 3 + 3 + 4) * (FMT_NUM_MAX + 1) + 1];
+    char *p;
+
+    if (outputFormat == OUTPUT_BINARY) {
+        // Binary records carry sensor reports only
+        return;
+    }
+
+    p = fmt_str(line, "F ");
+    p = fmt_timeUs(p, pRecord->timestamp_us, 0, 6);
+    for (int n = 0; n < 3; n++) {
+        p = putFloat(p, " ", pRecord->acc[n]);
+    }
+    for (int n = 0; n < 3; n++) {
+        p = putFloat(p, " ", pRecord->gyro[n]);
+    }
+    for (int n = 0; n < 4; n++) {
+        p = putFloat(p, " ", pRecord->orientation[n]);
+    }
+    putLine(line, p);
+}
+
+// Start fusing accelerometer, gyroscope and game rotation vector onto a
+// common time grid, enabling the sensors if needed.
+static void startFused(uint32_t rate_hz)
+{
+    static const sh2_SensorId_t inputs[] = {
+        SH2_ACCELEROMETER,
+        SH2_GYROSCOPE_CALIBRATED,
+        SH2_GAME_ROTATION_VECTOR,
+    };
+    int status;
+
+    if (!resample_start(inputs[0], inputs[1], inputs[2], 1000000 / rate_hz, printFused, 0)) {
+        printf("Too many sensors tracked.\n");
+        return;
+    }
+
+    for (int n = 0; n < ARRAY_LEN(inputs); n++) {
+        if (!sensorEnabled[inputs[n]]) {
+            sensorEnabled[inputs[n]] = true;
+            status = applySensorConfig(inputs[n]);
+            if (status != SH2_OK) {
+                printf("Error %d configuring sensor %d\n", status, inputs[n]);
+            }
+        }
+    }
+}
+
+// Send text output (command responses, help) as stream text records
+static void streamText(const uint8_t *pText, unsigned len)
+{
+    stream_sendText(pText, len);
+}
+
+// Start or stop the binary stream.  While it runs, all console output is
+// framed: sensor events, log messages and text.
+static void setBinaryOutput(bool binary)
+{
+    log_setBinary(binary);
+    if (binary) {
+        stream_reset();
+        console_setTextHandler(streamText);
+    }
+    else {
+        console_setTextHandler(0);
+    }
+}
+
+// Select a new output format
+static void setOutputFormat(const char *name)
+{
+    if (strcmp(name, "text") == 0) {
+        outputFormat = OUTPUT_TEXT;
+        setBinaryOutput(false);
+        setTextPolicies(true);
+    }
+    else if (strcmp(name, "dsf") == 0) {
+        outputFormat = OUTPUT_DSF;
+        setBinaryOutput(false);
+        setTextPolicies(false);
+        printDsfHeaders();
+    }
+    else if (strcmp(name, "binary") == 0) {
+        outputFormat = OUTPUT_BINARY;
+        setBinaryOutput(true);
+        setTextPolicies(false);
+    }
+    else {
+        printf("Unknown format: %s\n", name);
+    }
+}
+
+// Console line handler: parse and execute one command.
+// Sensor changes take effect immediately and persist across sensor hub resets.
+static void onCommand(void *cookie, const char *line)
+{
+    char cmd[8], arg1[12], arg2[12], arg3[8];
+    int sensorId = -1;
+    uint32_t value = 0;
+    int status = SH2_OK;
+    int args;
+
+    args = sscanf(line, "%7s %11s %11s %7s", cmd, arg1, arg2, arg3);
+    if (args < 1) {
+        return;
+    }
+
+    // Batch interval for all sensors
+    if ((strcmp(cmd, "batch") == 0) && (args >= 2) && (strcmp(arg1, "all") == 0)) {
+        if ((args < 3) || !parseUint(arg2, &value)) {
+            printf("Bad or missing value.\n");
+            return;
+        }
+        setBatchInterval(value);
+        return;
+    }
+
+    // Prediction commands without a sensor
+    if ((strcmp(cmd, "predict") == 0) && (args >= 2)) {
+        if (strcmp(arg1, "off") == 0) {
+            predict_stop();
+            return;
+        }
+        if (strcmp(arg1, "check") == 0) {
+            printPredictionStats();
+            return;
+        }
+    }
+
+    // Commands that take a sensor argument
+    if ((strcmp(cmd, "on") == 0) || (strcmp(cmd, "off") == 0) ||
+        (strcmp(cmd, "rate") == 0) || (strcmp(cmd, "batch") == 0) ||
+        (strcmp(cmd, "sens") == 0) || (strcmp(cmd, "out") == 0) ||
+        (strcmp(cmd, "track") == 0) || (strcmp(cmd, "untrack") == 0) ||
+        (strcmp(cmd, "hist") == 0) || (strcmp(cmd, "euler") == 0) ||
+        (strcmp(cmd, "predict") == 0)) {
+        if (args >= 2) {
+            sensorId = parseSensor(arg1);
+        }
+        if (sensorId < 0) {
+            printf("Bad or missing sensor.\n");
+            return;
+        }
+        if ((strcmp(cmd, "rate") == 0) || (strcmp(cmd, "batch") == 0) ||
+            (strcmp(cmd, "sens") == 0) || (strcmp(cmd, "hist") == 0) ||
+            (strcmp(cmd, "euler") == 0) || (strcmp(cmd, "predict") == 0)) {
+            if ((args < 3) || !parseUint(arg2, &value)) {
+                printf("Bad or missing value.\n");
+                return;
+            }
+        }
+    }
+
+    if (strcmp(cmd, "on") == 0) {
+        sensorEnabled[sensorId] = true;
+        status = applySensorConfig(sensorId);
+    }
+    else if (strcmp(cmd, "off") == 0) {
+        sensorEnabled[sensorId] = false;
+        status = applySensorConfig(sensorId);
+    }
+    else if (strcmp(cmd, "rate") == 0) {
+        if ((value == 0) || (value > 1000000)) {
+            printf("Rate must be 1 to 1000000 Hz.\n");
+            return;
+        }
+        sensorConfig[sensorId].reportInterval_us = 1000000 / value;
+        sensorEnabled[sensorId] = true;
+        status = applySensorConfig(sensorId);
+    }
+    else if (strcmp(cmd, "batch") == 0) {
+        sensorConfig[sensorId].batchInterval_us = value;
+        status = applySensorConfig(sensorId);
+    }
+    else if (strcmp(cmd, "sens") == 0) {
+        if (value > 0xFFFF) {
+            printf("Sensitivity must be 0 to 65535.\n");
+            return;
+        }
+        sensorConfig[sensorId].changeSensitivity = (uint16_t)value;
+        sensorConfig[sensorId].changeSensitivityEnabled = (value != 0);
+        sensorConfig[sensorId].changeSensitivityRelative =
+            (args >= 4) && (strcmp(arg3, "rel") == 0);
+        status = applySensorConfig(sensorId);
+    }
+    else if (strcmp(cmd, "out") == 0) {
+        if ((args >= 3) && (strcmp(arg2, "all") == 0)) {
+            setOutputPolicy(sensorId, OUTPUT_ALL, 0);
+        }
+        else if ((args < 4) || !parseUint(arg3, &value) || (value == 0)) {
+            printf("Bad or missing value.\n");
+        }
+        else if (strcmp(arg2, "every") == 0) {
+            setOutputPolicy(sensorId, OUTPUT_EVERY_NTH, value);
+        }
+        else if (strcmp(arg2, "max") == 0) {
+            setOutputPolicy(sensorId, OUTPUT_MAX_RATE, 1000000 / value);
+        }
+        else if (strcmp(arg2, "latest") == 0) {
+            setOutputPolicy(sensorId, OUTPUT_LATEST, 1000000 / value);
+        }
+        else {
+            printf("Unknown output mode: %s\n", arg2);
+        }
+    }
+    else if (strcmp(cmd, "track") == 0) {
+        if (!samples_track(sensorId)) {
+            printf("At most %u sensors can be tracked.\n", SAMPLES_MAX_SENSORS);
+        }
+    }
+    else if (strcmp(cmd, "untrack") == 0) {
+        samples_untrack(sensorId);
+    }
+    else if (strcmp(cmd, "hist") == 0) {
+        printHistory(sensorId, value);
+    }
+    else if (strcmp(cmd, "euler") == 0) {
+        printEuler(sensorId, value);
+    }
+    else if (strcmp(cmd, "predict") == 0) {
+        startPrediction(sensorId, value);
+    }
+    else if ((strcmp(cmd, "fuse") == 0) && (args >= 2)) {
+        if (strcmp(arg1, "off") == 0) {
+            resample_stop();
+        }
+        else if (!parseUint(arg1, &value) || (value == 0) || (value > 1000)) {
+            printf("Rate must be 1 to 1000 Hz.\n");
+        }
+        else {
+            startFused(value);
+        }
+    }
+    else if ((strcmp(cmd, "format") == 0) && (args >= 2)) {
+        setOutputFormat(arg1);
+    }
+    else if ((strcmp(cmd, "baud") == 0) && (args >= 2)) {
+        // The console announces each new rate itself, at that rate.
+        if (strcmp(arg1, "auto") == 0) {
+            if (!console_autoBaud(BAUD_AUTO_STEP_MS)) {
+                printf("Baud rate change in progress.\n");
+            }
+        }
+        else if (!parseUint(arg1, &value) || !console_changeBaud(value, BAUD_CONFIRM_MS)) {
+            printf("Unsupported baud rate, or a change is in progress.\n");
+        }
+    }
+    else if (strcmp(cmd, "show") == 0) {
+        printSensorConfig();
+    }
+    else if (strcmp(cmd, "stats") == 0) {
+        printConsoleStats(STATS_COMMAND);
+        printEventStats(STATS_COMMAND);
+        printServiceStats(STATS_COMMAND);
+        printFusedStats();
+        printSequenceStats();
+        printResetStats();
+        printBootTimeline();
+    }
+    else {
+        printHelp();
+    }
+
+    if (status != SH2_OK) {
+        printf("Error %d configuring sensor %d\n", status, sensorId);
+    }
+}
+
+// Service the sensor hub, counting wakeups and their cost.
+// With batching, reports arrive in bursts of large transfers, possibly
+// more than one buffered in the HAL.  Keep servicing while transfers
+// deliver events, up to SERVICE_MAX_PASSES, so a burst is drained
+// together rather than interleaved with console output.  A burst that
+// delivered events counts as one wakeup.
+static void serviceSensorHub(void)
+{
+    uint32_t burstEvents = eventCount;
+    uint32_t start = dbg_cycles();
+
+    for (int pass = 0; pass < SERVICE_MAX_PASSES; pass++) {
+        uint32_t events = eventCount;
+        
+        sh2_service();
+        
+        if (eventCount == events) {
+            // Nothing delivered
+            break;
+        }
+    }
+
+    if (eventCount != burstEvents) {
+        serviceWakeups++;
+        serviceCycles += dbg_cycles() - start;
+    }
 }
 
 // --- Public methods -------------------------------------------------
@@ -430,17 +1591,33 @@ void demo_init(void)
 {
     int status;
     
+    boot_mark(BOOT_APP_INIT);
+    
+    if (outputFormat == OUTPUT_BINARY) {
+        // Frame everything from the start, so the host can decode it all
+        setBinaryOutput(true);
+    }
+
     printf("\n\n");
     printf("Hillcrest SH2 Demo.\n");
+
+#ifdef FORMAT_BENCHMARK
+    benchmarkFormat();
+#endif
+
+#ifdef ORIENTATION_BENCHMARK
+    benchmarkOrientation();
+#endif
     
 #ifdef PERFORM_DFU
     printf("DFU Process started.  (Completes in about 25 seconds.)\n");
+    uint32_t dfuStart_ms = HAL_GetTick();
     status = dfu();
     if (status == SH2_OK) {
-        printf("DFU completed successfully.\n");
+        log_msg(LOG_DFU_OK, HAL_GetTick() - dfuStart_ms);
     }
     else {
-        printf("DFU failed.  Error=%d.\n", status);
+        log_msg(LOG_DFU_ERROR, status);
     }
 #endif
 
@@ -450,25 +1627,38 @@ void demo_init(void)
     // Open SH2 interface (also registers non-sensor event handler.)
     status = sh2_open(pSh2Hal, eventHandler, NULL);
     if (status != SH2_OK) {
-        printf("Error, %d, from sh2_open.\n", status);
+        log_msg(LOG_SH2_OPEN_ERROR, status);
     }
+    boot_mark(BOOT_SH2_OPEN);
 
     // Register sensor listener
     sh2_setSensorCallback(sensorHandler, NULL);
 
-#ifdef DSF_OUTPUT
-    // Print DSF file headers
-    printDsfHeaders();
-#else
-    // Read and display BNO080 product ids
-    reportProdIds();
-#endif
+    // Accept sensor configuration commands from the console
+    initSensorConfig();
+
+    setTextPolicies(outputFormat == OUTPUT_TEXT);
+    console_setLineHandler(onCommand, NULL);
+
+    if (outputFormat == OUTPUT_DSF) {
+        // Print DSF file headers
+        printDsfHeaders();
+    }
+    else if (outputFormat == OUTPUT_BINARY) {
+        // Binary stream started above, only sensor records follow
+    }
+    else {
+        // Read and display BNO080 product ids, once sensors are configured
+        // so as not to delay the first sample.  Then show the boot timeline.
+        prodIdsPending = true;
+        bootTimelinePending = true;
+    }
 
     // resetOccurred would have been set earlier.
     // We can reset it since we are starting the sensor reports now.
     resetOccurred = false;
 
-    // Start the flow of sensor reports
+    // Start the flow of sensor reports (sent by demo_service)
     startReports();
 }
 
@@ -481,11 +1671,36 @@ void demo_service(void)
         resetOccurred = false;
         startReports();
     }
+
+    // Configure sensors after a reset
+    serviceReplay();
+
+    // Startup reports
+    if (prodIdsPending && (replayNext >= replayLen)) {
+        prodIdsPending = false;
+        reportProdIds();
+    }
+    if (bootTimelinePending) {
+        uint32_t firstSample_us;
+        if (boot_time(BOOT_FIRST_SAMPLE, &firstSample_us)) {
+            bootTimelinePending = false;
+            printBootTimeline();
+        }
+    }
     
     // Service the sensor hub.
     // Sensor reports and event processing handled by callbacks.
-    sh2_service();
-}
+    serviceSensorHub();
 
+    // Output fused records for grid points all inputs have passed
+    resample_service();
 
+    // Output latest values on their timers
+    serviceLatest();
 
+    reportSequenceStats();
+
+#ifdef CONSOLE_STATS
+    reportConsoleStats();
+#endif
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Integer-only text formatting for sensor values.
+ *
+ * Floats are split into mantissa and exponent and scaled exactly in 64-bit
+ * integers, so the digits match printf without any floating point math.
+ */
+
+#include "fmt.h"
+
+#include <string.h>
+
+// Max decimals supported by fmt_float and fmt_timeUs
+#define MAX_DECIMALS (6)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static const uint32_t pow10[MAX_DECIMALS+1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000,
+};
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// Store the decimal digits of x, most significant first
+static char *putDigits(char *p, uint64_t x)
+{
+    char tmp[20];
+    unsigned n = 0;
+
+    // Use 32-bit division where possible, it's much cheaper.
+    while (x > 0xFFFFFFFF) {
+        tmp[n++] = '0' + (char)(x % 10);
+        x /= 10;
+    }
+    uint32_t x32 = (uint32_t)x;
+    do {
+        tmp[n++] = '0' + (char)(x32 % 10);
+        x32 /= 10;
+    } while (x32 != 0);
+
+    while (n > 0) {
+        *p++ = tmp[--n];
+    }
+
+    return p;
+}
+
+// Store exactly <decimals> digits of frac, with leading zeros
+static char *putFraction(char *p, uint32_t frac, unsigned decimals)
+{
+    for (unsigned n = decimals; n > 0; n--) {
+        p[n-1] = '0' + (char)(frac % 10);
+        frac /= 10;
+    }
+
+    return p + decimals;
+}
+
+// Copy len chars of text right aligned in width
+static char *putPadded(char *p, const char *text, unsigned len, unsigned width)
+{
+    while (width > len) {
+        *p++ = ' ';
+        width--;
+    }
+    memcpy(p, text, len);
+
+    return p + len;
+}
+
+// Store sign, integer part, then a point and fraction if decimals > 0
+static char *putFixed(char *p, unsigned width, unsigned decimals,
+                      int negative, uint64_t ipart, uint32_t frac)
+{
+    char text[FMT_NUM_MAX];
+    char *q = text;
+
+    if (negative) {
+        *q++ = '-';
+    }
+    q = putDigits(q, ipart);
+    if (decimals > 0) {
+        *q++ = '.';
+        q = putFraction(q, frac, decimals);
+    }
+
+    return putPadded(p, text, (unsigned)(q - text), width);
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+char *fmt_str(char *p, const char *s)
+{
+    while (*s) {
+        *p++ = *s++;
+    }
+
+    return p;
+}
+
+char *fmt_int(char *p, int32_t x)
+{
+    if (x < 0) {
+        *p++ = '-';
+        return putDigits(p, (uint32_t)0 - (uint32_t)x);
+    }
+
+    return putDigits(p, (uint32_t)x);
+}
+
+char *fmt_uint(char *p, uint32_t x)
+{
+    return putDigits(p, x);
+}
+
+char *fmt_float(char *p, float x, unsigned width, unsigned decimals)
+{
+    uint32_t bits;
+    uint32_t mant;
+    int exp;
+    int negative;
+    uint64_t ipart;
+    uint64_t frac;
+
+    if (decimals > MAX_DECIMALS) {
+        decimals = MAX_DECIMALS;
+    }
+
+    // x = mant * 2^exp
+    memcpy(&bits, &x, sizeof(bits));
+    negative = (bits >> 31) != 0;
+    exp = (int)((bits >> 23) & 0xFF);
+    mant = bits & 0x7FFFFF;
+    if (exp == 0xFF) {
+        if (mant != 0) {
+            return putPadded(p, "nan", 3, width);
+        }
+        return negative ? putPadded(p, "-inf", 4, width) : putPadded(p, "inf", 3, width);
+    }
+    if (exp == 0) {
+        // Denormal
+        exp = -149;
+    }
+    else {
+        mant |= 0x800000;
+        exp -= 150;
+    }
+
+    if (exp >= 0) {
+        // Integer valued
+        if (exp > 39) {
+            return putPadded(p, "ovf", 3, width);
+        }
+        ipart = (uint64_t)mant << exp;
+        frac = 0;
+    }
+    else {
+        unsigned shift = (unsigned)-exp;
+
+        // Split into integer and fractional parts, then scale the
+        // fraction to decimal digits, rounding to nearest.
+        if (shift < 32) {
+            ipart = mant >> shift;
+            frac = mant & ((1u << shift) - 1);
+        }
+        else {
+            ipart = 0;
+            frac = mant;
+        }
+        if (shift < 64) {
+            // Round half to even, as printf does
+            uint64_t scaled = frac * pow10[decimals];
+            uint64_t half = (uint64_t)1 << (shift - 1);
+            uint64_t rem = scaled & ((half << 1) - 1);
+            
+            frac = scaled >> shift;
+            if ((rem > half) ||
+                ((rem == half) && (((decimals > 0) ? frac : ipart) & 1))) {
+                frac++;
+            }
+        }
+        else {
+            frac = 0;
+        }
+        if (frac >= pow10[decimals]) {
+            frac -= pow10[decimals];
+            ipart++;
+        }
+    }
+
+    return putFixed(p, width, decimals, negative, ipart, (uint32_t)frac);
+}
+
+char *fmt_timeUs(char *p, uint64_t t_us, unsigned width, unsigned decimals)
+{
+    uint64_t ipart;
+    uint32_t frac;
+    uint32_t unit;
+
+    if (decimals > MAX_DECIMALS) {
+        decimals = MAX_DECIMALS;
+    }
+
+    // Round microseconds to the number of decimals shown
+    unit = pow10[MAX_DECIMALS - decimals];
+    t_us += unit / 2;
+    ipart = t_us / 1000000;
+    frac = (uint32_t)(t_us % 1000000) / unit;
+
+    return putFixed(p, width, decimals, 0, ipart, frac);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Integer-only text formatting for sensor values.
+ *
+ * Each function stores text at p, without a terminating NUL, and returns a
+ * pointer just past it so calls can be chained to build a line.  The caller
+ * provides enough space.
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+// Longest text from fmt_float or fmt_timeUs, excluding width padding
+#define FMT_NUM_MAX (32)
+
+// Copy a string
+char *fmt_str(char *p, const char *s);
+
+// Signed decimal, like printf "%d"
+char *fmt_int(char *p, int32_t x);
+
+// Unsigned decimal, like printf "%u"
+char *fmt_uint(char *p, uint32_t x);
+
+// Fixed point decimal, like printf "%<width>.<decimals>f" (decimals <= 6).
+// Magnitudes of 2^63 or more are shown as "ovf".
+char *fmt_float(char *p, float x, unsigned width, unsigned decimals);
+
+// Timestamp in microseconds shown as seconds, like fmt_float, but exact.
+char *fmt_timeUs(char *p, uint64_t t_us, unsigned width, unsigned decimals);
+
+#endif
@@ -22,13 +22,14 @@
 #include "sh2_hal_init.h"
 #include "sh2_hal.h"
 #include "sh2_err.h"
+#include "timebase.h"
+#include "boot.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 #include "stm32f4xx_hal.h"
-#include "stm32f4xx_hal_tim.h"
 #include "stm32f4xx_hal_i2c.h"
 
 #define CLKSEL0_PORT GPIOA
@@ -50,8 +51,13 @@
 #define INTN_PIN GPIO_PIN_10
 
 // Keep reset asserted this long.
-// (Some targets have a long RC decay on reset.)
+// (Some targets have a long RC decay on reset.  Boards without one can
+// define a shorter time, as measured from the boot timeline.)
+// The hold is fixed: no signal shows when reset has taken effect at the
+// hub.  RSTN is driven push-pull, so its input reads low at once.
+#ifndef RESET_DELAY_US
 #define RESET_DELAY_US (10000)
+#endif
 
 // Wait up to this long to see first interrupt from SH
 #define START_DELAY_US (2000000)
@@ -87,9 +93,6 @@ enum BusState_e {
 
 static bool isOpen = false;
 
-// Timer handle
-TIM_HandleTypeDef tim2;
-
 // I2C Peripheral, I2C1
 I2C_HandleTypeDef i2c;
 
@@ -247,26 +250,8 @@ static void hal_init_i2c(void)
     HAL_NVIC_SetPriority(I2C1_ER_IRQn, 5, 0);
 }
 
-static void hal_init_timer(void)
-{
-    __HAL_RCC_TIM2_CLK_ENABLE();
-    
-    // Prescale to get 1 count per uS
-    uint32_t prescaler = (uint32_t)((HAL_RCC_GetPCLK2Freq() / 1000000) - 1);
-
-    tim2.Instance = TIM2;
-    tim2.Init.Period = 0xFFFFFFFF;
-    tim2.Init.Prescaler = prescaler;
-    tim2.Init.ClockDivision = 0;
-    tim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-
-    HAL_TIM_Base_Init(&tim2);
-    HAL_TIM_Base_Start(&tim2);
-}
-
 static void hal_init_hw(void)
 {
-    hal_init_timer();
     hal_init_gpio();
     hal_init_i2c();
 }
@@ -297,17 +282,12 @@ static void ps1(bool state)
 
 static uint32_t timeNowUs(void)
 {
-    return __HAL_TIM_GET_COUNTER(&tim2);
+    return (uint32_t)timebase_nowUs();
 }
 
 static void delay_us(uint32_t t)
 {
-    uint32_t now = timeNowUs();
-    uint32_t start = now;
-    while ((now - start) < t)
-    {
-        now = timeNowUs();
-    }
+    timebase_delayUs(t);
 }
 
 static void reset_delay_us(uint32_t t)
@@ -443,6 +423,7 @@ static int sh2_i2c_hal_open(sh2_Hal_t *self)
     i2cAddr = ADDR_SH2_0 << 1;
 
     isOpen = true;
+    boot_mark(BOOT_HAL_OPEN);
 
     // Init hardware peripherals
     hal_init_hw();
@@ -476,9 +457,13 @@ static int sh2_i2c_hal_open(sh2_Hal_t *self)
     
     // Deassert reset
     rstn(1);
+    boot_mark(BOOT_RESET_RELEASED);
 
     // Wait for INTN to be asserted
     reset_delay_us(START_DELAY_US);
+    if (!inReset) {
+        boot_mark(BOOT_HUB_READY);
+    }
 
     return SH2_OK;
 }
@@ -497,9 +482,6 @@ static void sh2_i2c_hal_close(sh2_Hal_t *self)
     // Deinit I2C peripheral
     HAL_I2C_DeInit(&i2c);
     
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
-    
     isOpen = false;
 }
 
@@ -647,9 +629,6 @@ static void dfu_i2c_hal_close(sh2_Hal_t *self)
     // Deinit I2C peripheral
     HAL_I2C_DeInit(&i2c);
 
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
-    
     isOpen = false;
 }
 
@@ -750,3 +729,8 @@ sh2_Hal_t *dfu_hal_init(void)
 
     return &dfuHal;
 }
+
+void dfu_hal_waitRx(sh2_Hal_t *self, uint32_t timeout_us)
+{
+    // Nothing to wait for: each DFU read is a bus transfer started by read.
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Deferred logging.
+ */
+
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ring.h"
+#include "stream.h"
+
+// Log buffer size, a power of 2.
+#define LOG_BUFLEN (512)
+
+// Stored record: message id, then its arguments.
+#define HEADER_LEN (2)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static const struct {
+    uint8_t numArgs;
+    const char *format;
+} logMsgs[LOG_NUM_MSGS] = {
+#define LOG_MSG(id, numArgs, format) {numArgs, format},
+#include "log_msgs.h"
+#undef LOG_MSG
+};
+
+static uint8_t logBuffer[LOG_BUFLEN];
+static Ring_t logRing;
+static bool logInitialized = false;
+static bool logBinary = false;
+static uint32_t logDrops;
+
+// ------------------------------------------------------------------------
+// Public API
+
+void log_msg(LogMsgId_t id, ...)
+{
+    uint8_t record[HEADER_LEN + LOG_MAX_ARGS*sizeof(uint32_t)];
+    uint32_t arg;
+    unsigned numArgs = logMsgs[id].numArgs;
+    unsigned len = HEADER_LEN + numArgs*sizeof(uint32_t);
+    va_list ap;
+
+    if (!logInitialized) {
+        ring_init(&logRing, logBuffer, sizeof(logBuffer));
+        logInitialized = true;
+    }
+
+    if (ring_free(&logRing) < len) {
+        logDrops++;
+        return;
+    }
+    
+    record[0] = (uint8_t)id;
+    record[1] = (uint8_t)(id >> 8);
+    va_start(ap, id);
+    for (unsigned n = 0; n < numArgs; n++) {
+        arg = va_arg(ap, uint32_t);
+        memcpy(&record[HEADER_LEN + n*sizeof(uint32_t)], &arg, sizeof(arg));
+    }
+    va_end(ap);
+
+    ring_insert(&logRing, record, len);
+}
+
+void log_service(void)
+{
+    uint8_t header[HEADER_LEN];
+    uint32_t args[LOG_MAX_ARGS] = {0};
+    unsigned id;
+    uint32_t drops;
+
+    if (!logInitialized) {
+        return;
+    }
+
+    // Report drops once there is room to
+    drops = logDrops;
+    if ((drops > 0) && (ring_free(&logRing) >= HEADER_LEN + sizeof(uint32_t))) {
+        logDrops -= drops;
+        log_msg(LOG_DROPPED, drops);
+    }
+
+    while (ring_remove(&logRing, header, HEADER_LEN) != 0) {
+        id = header[0] + (header[1] << 8);
+        ring_remove(&logRing, (uint8_t *)args, logMsgs[id].numArgs*sizeof(uint32_t));
+
+        if (logBinary) {
+            stream_sendLog(id, args, logMsgs[id].numArgs);
+        }
+        else {
+            // Unused trailing arguments are ignored by printf
+            printf(logMsgs[id].format, args[0], args[1], args[2], args[3]);
+        }
+    }
+}
+
+void log_setBinary(bool binary)
+{
+    logBinary = binary;
+}
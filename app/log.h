@@ -0,0 +1,56 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Deferred logging.
+ *
+ * log_msg stores a message id and its integer arguments in a buffer, which
+ * takes a few dozen cycles.  log_service, called from the main loop, later
+ * formats the messages as text or, in binary mode, sends them as stream
+ * records (see stream.h) for a host tool to format.
+ *
+ * Messages are defined in log_msgs.h.  log_msg may only be called from the
+ * main loop, not from interrupts.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+
+// Message ids
+typedef enum {
+#define LOG_MSG(id, numArgs, format) id,
+#include "log_msgs.h"
+#undef LOG_MSG
+    LOG_NUM_MSGS
+} LogMsgId_t;
+
+// Most arguments a message may have
+#define LOG_MAX_ARGS (4)
+
+// Store a message, followed by the number of int arguments given in log_msgs.h.
+// If the buffer is full the message is dropped and counted.
+void log_msg(LogMsgId_t id, ...);
+
+// Output stored messages.  Call from the main loop.
+void log_service(void);
+
+// Select binary (stream records) or text output.
+void log_setBinary(bool binary);
+
+#endif
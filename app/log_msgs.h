@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Log message table.
+ *
+ * LOG_MSG(id, numArgs, format)
+ *
+ * Message ids are assigned in order, starting from 0.  Binary log records
+ * carry only the id and arguments, so the host decoder (tools/sh2stream)
+ * builds this table in to format them.  Only append new messages, so ids
+ * stay stable across builds.
+ * Arguments are 32-bit integers: use %d, %u or %x conversions only.
+ */
+
+LOG_MSG(LOG_DROPPED,              1, "Log: %u messages dropped.\n")
+LOG_MSG(LOG_SH2_OPEN_ERROR,       1, "Error, %d, from sh2_open.\n")
+LOG_MSG(LOG_PROD_IDS_ERROR,       0, "Error from sh2_getProdIds.\n")
+LOG_MSG(LOG_ENABLE_ERROR,         1, "Error while enabling sensor %d\n")
+LOG_MSG(LOG_DECODE_ERROR,         1, "Error decoding sensor event: %d\n")
+LOG_MSG(LOG_UNKNOWN_SENSOR,       1, "Unknown sensor: %d\n")
+LOG_MSG(LOG_HUB_RESET,            0, "Sensor hub reset.\n")
+LOG_MSG(LOG_DFU_OK,               1, "DFU completed successfully in %u ms.\n")
+LOG_MSG(LOG_DFU_ERROR,            1, "DFU failed.  Error=%d.\n")
+LOG_MSG(LOG_CAL_START_ERROR,      1, "Error from sh2_startCal: %d\n")
+LOG_MSG(LOG_CAL_FINISH_ERROR,     1, "Error from sh2_finishCal: %d\n")
+LOG_MSG(LOG_BAUD_REVERTED,        1, "Baud rate not confirmed, back to %u.\n")
+LOG_MSG(LOG_SAMPLES_LOST,         4, "Sensor %d: lost %u, duplicate %u, late %u samples.\n")
+LOG_MSG(LOG_FIRST_SAMPLE,         3, "Sensor %d: configured %u us, first sample %u us after reset.\n")
+LOG_MSG(LOG_BAUD_CONFIRMED,       1, "Console at %u baud, confirmed.\n")
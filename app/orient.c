@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation math.
+ *
+ * The rotation matrix of unit quaternion (w, x, y, z) is
+ *
+ *   1 - 2(yy + zz)    2(xy - wz)        2(xz + wy)
+ *   2(xy + wz)        1 - 2(xx + zz)    2(yz - wx)
+ *   2(xz - wy)        2(yz + wx)        1 - 2(xx + yy)
+ *
+ * The kernels build it from element-wise products over blocks of
+ * samples, which CMSIS-DSP unrolls into FPU pipelined loops.  Euler angles
+ * come from five matrix elements, with the inverse trig done per sample.
+ *
+ * One quaternion at a time functions are in orient_ref.c.
+ */
+
+#include "orient.h"
+
+#include <math.h>
+
+#include "stm32f4xx.h"
+#include "arm_math.h"
+
+// Samples per block: sizes the scratch arrays on the stack
+#define BLOCK_LEN (32)
+
+// Quaternion components
+enum { W, X, Y, Z };
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// pOut = 1 - 2(a*a + b*b)
+static void diagonal(const float *a, const float *b, float *pOut, float *pScratch, unsigned n)
+{
+    arm_mult_f32((float *)a, (float *)a, pOut, n);
+    arm_mult_f32((float *)b, (float *)b, pScratch, n);
+    arm_add_f32(pOut, pScratch, pOut, n);
+    arm_scale_f32(pOut, -2.0f, pOut, n);
+    arm_offset_f32(pOut, 1.0f, pOut, n);
+}
+
+// pSum = 2(a*b + c*d), pDiff = 2(a*b - c*d)
+static void offDiagonal(const float *a, const float *b, const float *c, const float *d,
+                        float *pSum, float *pDiff, float *pScratch, unsigned n)
+{
+    arm_mult_f32((float *)a, (float *)b, pSum, n);
+    arm_mult_f32((float *)c, (float *)d, pScratch, n);
+    arm_sub_f32(pSum, pScratch, pDiff, n);
+    arm_add_f32(pSum, pScratch, pSum, n);
+    arm_scale_f32(pSum, 2.0f, pSum, n);
+    arm_scale_f32(pDiff, 2.0f, pDiff, n);
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+void orient_quatToMatrix(const float * const pQ[4], float * const pM[9], unsigned n)
+{
+    float scratch[BLOCK_LEN];
+
+    for (unsigned base = 0; base < n; base += BLOCK_LEN) {
+        unsigned len = ((n - base) < BLOCK_LEN) ? (n - base) : BLOCK_LEN;
+        const float *w = pQ[W] + base;
+        const float *x = pQ[X] + base;
+        const float *y = pQ[Y] + base;
+        const float *z = pQ[Z] + base;
+
+        diagonal(y, z, pM[0] + base, scratch, len);
+        diagonal(x, z, pM[4] + base, scratch, len);
+        diagonal(x, y, pM[8] + base, scratch, len);
+        offDiagonal(x, y, w, z, pM[3] + base, pM[1] + base, scratch, len);
+        offDiagonal(x, z, w, y, pM[2] + base, pM[6] + base, scratch, len);
+        offDiagonal(y, z, w, x, pM[7] + base, pM[5] + base, scratch, len);
+    }
+}
+
+void orient_quatToEuler(const float * const pQ[4],
+                        float *pYaw, float *pPitch, float *pRoll, unsigned n)
+{
+    float m00[BLOCK_LEN], m10[BLOCK_LEN], m20[BLOCK_LEN], m21[BLOCK_LEN], m22[BLOCK_LEN];
+    float unused[BLOCK_LEN];
+    float scratch[BLOCK_LEN];
+
+    for (unsigned base = 0; base < n; base += BLOCK_LEN) {
+        unsigned len = ((n - base) < BLOCK_LEN) ? (n - base) : BLOCK_LEN;
+        const float *w = pQ[W] + base;
+        const float *x = pQ[X] + base;
+        const float *y = pQ[Y] + base;
+        const float *z = pQ[Z] + base;
+
+        diagonal(y, z, m00, scratch, len);
+        diagonal(x, y, m22, scratch, len);
+        offDiagonal(x, y, w, z, m10, unused, scratch, len);
+        offDiagonal(x, z, w, y, unused, m20, scratch, len);
+        offDiagonal(y, z, w, x, m21, unused, scratch, len);
+
+        for (unsigned i = 0; i < len; i++) {
+            float s = -m20[i];
+            
+            // Rounding can take |sin(pitch)| just past 1
+            if (s > 1.0f) {
+                s = 1.0f;
+            }
+            else if (s < -1.0f) {
+                s = -1.0f;
+            }
+            pYaw[base + i] = atan2f(m10[i], m00[i]);
+            pPitch[base + i] = asinf(s);
+            pRoll[base + i] = atan2f(m21[i], m22[i]);
+        }
+    }
+}
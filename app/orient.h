@@ -0,0 +1,61 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation math.
+ *
+ * Batch kernels convert arrays of unit quaternions to rotation matrices
+ * and Euler angles, using CMSIS-DSP vector operations.  Arrays are
+ * structure of arrays, as in sample store slices (samples.h): one array
+ * per quaternion component, in the order real, i, j, k.
+ *
+ * Matrices rotate sensor frame vectors into the world frame.  Euler
+ * angles are Z-Y-X (yaw, pitch, roll) in radians.
+ *
+ * The one quaternion at a time functions (orient_ref.c) are plain C and
+ * build on a host as well.  The orient_ref conversions are references for
+ * checking the kernels (orient.c), which need CMSIS-DSP.
+ *
+ * Single quaternion functions take and return (real, i, j, k) arrays.
+ */
+
+#ifndef ORIENT_H
+#define ORIENT_H
+
+// Convert n quaternions to rotation matrices.
+// pM[r*3 + c] receives the n values of row r, column c.
+void orient_quatToMatrix(const float * const pQ[4], float * const pM[9], unsigned n);
+
+// Convert n quaternions to Euler angles.
+void orient_quatToEuler(const float * const pQ[4],
+                        float *pYaw, float *pPitch, float *pRoll, unsigned n);
+
+// Reference conversions of one quaternion (real, i, j, k)
+void orient_refQuatToMatrix(const float q[4], float m[9]);
+void orient_refQuatToEuler(const float q[4], float *pYaw, float *pPitch, float *pRoll);
+
+// Spherical linear interpolation from unit quaternion a (f = 0) to b (f = 1)
+void orient_slerp(const float a[4], const float b[4], float f, float out[4]);
+
+// Rotate orientation q by constant angular velocity w (rad/s, sensor frame)
+// for dt seconds.
+void orient_integrate(const float q[4], const float w[3], float dt, float out[4]);
+
+// Angle of the rotation between unit quaternions a and b, in radians
+float orient_angle(const float a[4], const float b[4]);
+
+#endif
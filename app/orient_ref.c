@@ -0,0 +1,147 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation math, one quaternion at a time, in plain C.
+ *
+ * No CMSIS or target headers, so this also builds on a host, where the
+ * reference conversions check the CMSIS-DSP kernels in orient.c.
+ */
+
+#include "orient.h"
+
+#include <math.h>
+
+// Above this cosine of the angle between quaternions, SLERP is replaced by
+// normalized linear interpolation, which is accurate and avoids dividing
+// by a tiny sine.
+#define SLERP_LINEAR_LIMIT (0.9995f)
+
+// Below this rotation angle (radians), integration uses the small angle
+// approximation sin(x) = x.
+#define SMALL_ANGLE (1.0e-6f)
+
+// Quaternion components
+enum { W, X, Y, Z };
+
+// ------------------------------------------------------------------------
+// Public API
+
+void orient_refQuatToMatrix(const float q[4], float m[9])
+{
+    float w = q[W], x = q[X], y = q[Y], z = q[Z];
+
+    m[0] = 1.0f - 2.0f*(y*y + z*z);
+    m[1] = 2.0f*(x*y - w*z);
+    m[2] = 2.0f*(x*z + w*y);
+    m[3] = 2.0f*(x*y + w*z);
+    m[4] = 1.0f - 2.0f*(x*x + z*z);
+    m[5] = 2.0f*(y*z - w*x);
+    m[6] = 2.0f*(x*z - w*y);
+    m[7] = 2.0f*(y*z + w*x);
+    m[8] = 1.0f - 2.0f*(x*x + y*y);
+}
+
+void orient_refQuatToEuler(const float q[4], float *pYaw, float *pPitch, float *pRoll)
+{
+    float w = q[W], x = q[X], y = q[Y], z = q[Z];
+    float s = 2.0f*(w*y - x*z);
+
+    if (s > 1.0f) {
+        s = 1.0f;
+    }
+    else if (s < -1.0f) {
+        s = -1.0f;
+    }
+    *pYaw = atan2f(2.0f*(x*y + w*z), 1.0f - 2.0f*(y*y + z*z));
+    *pPitch = asinf(s);
+    *pRoll = atan2f(2.0f*(y*z + w*x), 1.0f - 2.0f*(x*x + y*y));
+}
+
+void orient_slerp(const float a[4], const float b[4], float f, float out[4])
+{
+    float dot = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+    float sign = 1.0f;
+    float wa, wb;
+
+    // q and -q are the same rotation: take the short way round
+    if (dot < 0.0f) {
+        dot = -dot;
+        sign = -1.0f;
+    }
+
+    if (dot > SLERP_LINEAR_LIMIT) {
+        wa = 1.0f - f;
+        wb = f;
+    }
+    else {
+        float theta = acosf(dot);
+        float s = sinf(theta);
+        wa = sinf((1.0f - f) * theta) / s;
+        wb = sinf(f * theta) / s;
+    }
+    wb *= sign;
+
+    float norm = 0.0f;
+    for (unsigned n = 0; n < 4; n++) {
+        out[n] = wa * a[n] + wb * b[n];
+        norm += out[n] * out[n];
+    }
+    norm = 1.0f / sqrtf(norm);
+    for (unsigned n = 0; n < 4; n++) {
+        out[n] *= norm;
+    }
+}
+
+void orient_integrate(const float q[4], const float w[3], float dt, float out[4])
+{
+    float rate = sqrtf(w[0]*w[0] + w[1]*w[1] + w[2]*w[2]);
+    float half = 0.5f * rate * dt;
+    float d[4];
+    float s;
+
+    // Rotation by angle rate*dt about w: (cos(half), sin(half) * w/rate)
+    if (half < SMALL_ANGLE) {
+        d[W] = 1.0f;
+        s = 0.5f * dt;
+    }
+    else {
+        d[W] = cosf(half);
+        s = sinf(half) / rate;
+    }
+    d[X] = w[0] * s;
+    d[Y] = w[1] * s;
+    d[Z] = w[2] * s;
+
+    // Angular velocity is in the sensor frame, so the rotation applies
+    // first: out = q * d
+    out[W] = q[W]*d[W] - q[X]*d[X] - q[Y]*d[Y] - q[Z]*d[Z];
+    out[X] = q[W]*d[X] + q[X]*d[W] + q[Y]*d[Z] - q[Z]*d[Y];
+    out[Y] = q[W]*d[Y] - q[X]*d[Z] + q[Y]*d[W] + q[Z]*d[X];
+    out[Z] = q[W]*d[Z] + q[X]*d[Y] - q[Y]*d[X] + q[Z]*d[W];
+}
+
+float orient_angle(const float a[4], const float b[4])
+{
+    float dot = fabsf(a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]);
+
+    if (dot > 1.0f) {
+        dot = 1.0f;
+    }
+
+    return 2.0f * acosf(dot);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation prediction.
+ */
+
+#include "predict.h"
+
+#include "dbg.h"
+#include "orient.h"
+#include "samples.h"
+
+// ------------------------------------------------------------------------
+// Private data
+
+static bool running;
+static sh2_SensorId_t rvId;
+static sh2_SensorId_t gyroId;
+static uint32_t horizon_us;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// Get the sample of a sensor at or before t.  Returns false if none.
+static bool sampleAt(sh2_SensorId_t sensorId, uint64_t t_us, uint64_t *pT, float *pValues)
+{
+    SampleSlice_t slice;
+    
+    if (samples_around(sensorId, t_us, &slice) == 0) {
+        return false;
+    }
+
+    // The first sample of a slice is always in span 0
+    for (unsigned c = 0; c < slice.numComponents; c++) {
+        pValues[c] = slice.pValue[c][0][0];
+    }
+    *pT = slice.pTimestamp_us[0][0];
+
+    return true;
+}
+
+// Angular velocity at or before t, from the gyro source
+static bool angularVelocityAt(uint64_t t_us, float w[3])
+{
+    float values[SAMPLES_MAX_COMPONENTS];
+    uint64_t t;
+
+    if (!sampleAt(gyroId, t_us, &t, values)) {
+        return false;
+    }
+
+    // GIRV components: real, i, j, k, angular velocity x, y, z
+    const float *pW = (gyroId == SH2_GYRO_INTEGRATED_RV) ? &values[4] : &values[0];
+    w[0] = pW[0];
+    w[1] = pW[1];
+    w[2] = pW[2];
+
+    return true;
+}
+
+// Predict orientation q, sampled at t, forward by the horizon
+static bool predictFrom(uint64_t t_us, const float q[4], float out[4])
+{
+    float w[3];
+
+    if (!angularVelocityAt(t_us, w)) {
+        return false;
+    }
+    orient_integrate(q, w, (float)horizon_us * 1.0e-6f, out);
+
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+bool predict_start(sh2_SensorId_t rv, sh2_SensorId_t gyro, uint32_t horizon)
+{
+    predict_stop();
+
+    if ((gyro != SH2_GYRO_INTEGRATED_RV) && (gyro != SH2_GYROSCOPE_CALIBRATED)) {
+        return false;
+    }
+    if (!samples_track(rv)) {
+        return false;
+    }
+    if (!samples_track(gyro)) {
+        samples_untrack(rv);
+        return false;
+    }
+
+    rvId = rv;
+    gyroId = gyro;
+    horizon_us = horizon;
+    running = true;
+
+    return true;
+}
+
+void predict_stop(void)
+{
+    if (running) {
+        running = false;
+        samples_untrack(rvId);
+        samples_untrack(gyroId);
+    }
+}
+
+bool predict_isActive(sh2_SensorId_t sensorId)
+{
+    return running && (sensorId == rvId);
+}
+
+bool predict_latest(uint64_t *pTimestamp_us, float q[4])
+{
+    float values[SAMPLES_MAX_COMPONENTS];
+    uint64_t t;
+
+    if (!running || (samples_latest(rvId, &t, values) == 0)) {
+        return false;
+    }
+    if (!predictFrom(t, values, q)) {
+        return false;
+    }
+    *pTimestamp_us = t + horizon_us;
+
+    return true;
+}
+
+bool predict_evaluate(PredictStats_t *pStats)
+{
+    SampleSlice_t slice;
+    float sumError = 0.0f;
+    float sumHoldError = 0.0f;
+    uint32_t cycles = 0;
+    unsigned count = 0;
+    bool done = false;
+
+    pStats->maxError = 0.0f;
+    if (!running) {
+        return false;
+    }
+    
+    samples_last(rvId, SAMPLES_DEPTH, &slice);
+    for (unsigned span = 0; (span < 2) && !done; span++) {
+        for (unsigned n = 0; n < slice.count[span]; n++) {
+            uint64_t t = slice.pTimestamp_us[span][n];
+            float q[4], predicted[4], actual[4];
+            float before[4], after[4];
+            SampleSlice_t around;
+            uint64_t tBefore, tAfter;
+            uint32_t start;
+
+            for (unsigned c = 0; c < 4; c++) {
+                q[c] = slice.pValue[c][span][n];
+            }
+
+            // Actual orientation at t + horizon, interpolated between the
+            // samples either side
+            if (samples_around(rvId, t + horizon_us, &around) < 2) {
+                // Horizon passes the newest sample, and so it will for
+                // every later one
+                done = true;
+                break;
+            }
+            unsigned s1 = (around.count[0] > 1) ? 0 : 1;
+            unsigned i1 = (around.count[0] > 1) ? 1 : 0;
+            tBefore = around.pTimestamp_us[0][0];
+            tAfter = around.pTimestamp_us[s1][i1];
+            for (unsigned c = 0; c < 4; c++) {
+                before[c] = around.pValue[c][0][0];
+                after[c] = around.pValue[c][s1][i1];
+            }
+            orient_slerp(before, after,
+                         (float)(t + horizon_us - tBefore) / (float)(tAfter - tBefore), actual);
+
+            start = dbg_cycles();
+            if (!predictFrom(t, q, predicted)) {
+                // No angular velocity yet at t
+                continue;
+            }
+            cycles += dbg_cycles() - start;
+
+            float error = orient_angle(predicted, actual);
+            sumError += error;
+            sumHoldError += orient_angle(q, actual);
+            if (error > pStats->maxError) {
+                pStats->maxError = error;
+            }
+            count++;
+        }
+    }
+
+    pStats->count = count;
+    if (count == 0) {
+        return false;
+    }
+    pStats->meanError = sumError / (float)count;
+    pStats->meanHoldError = sumHoldError / (float)count;
+    pStats->cycles = cycles / count;
+
+    return true;
+}
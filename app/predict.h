@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation prediction.
+ *
+ * Extrapolates a rotation vector stream forward by a fixed horizon,
+ * assuming the latest angular velocity holds.  Angular velocity comes
+ * from the gyro integrated rotation vector or from the calibrated
+ * gyroscope.  Display pipelines use this to compensate transport and
+ * output latency.
+ *
+ * Inputs come from the sample store (samples.h), which predict_start
+ * sets to track both sensors.  predict_evaluate measures accuracy and
+ * cost by replaying the samples kept.  test/predict_replay.c runs the
+ * same predictor over a whole recorded DSF log on a host.
+ */
+
+#ifndef PREDICT_H
+#define PREDICT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sh2.h"
+
+// Prediction accuracy and cost over the sample history.
+// Errors are rotation angles in radians.
+typedef struct {
+    unsigned count;        // predictions checked
+    float meanError;       // predicted vs actual
+    float maxError;
+    float meanHoldError;   // latest sample, unpredicted, vs actual
+    uint32_t cycles;       // CPU cycles per prediction
+} PredictStats_t;
+
+// Start predicting rotation vector rv horizon_us ahead, with angular
+// velocity from gyro (SH2_GYRO_INTEGRATED_RV or SH2_GYROSCOPE_CALIBRATED).
+// Returns false if the sensors cannot be tracked or gyro is neither.
+bool predict_start(sh2_SensorId_t rv, sh2_SensorId_t gyro, uint32_t horizon_us);
+
+// Stop predicting and stop tracking the sensors.
+void predict_stop(void);
+
+// Returns true if predicting sensorId
+bool predict_isActive(sh2_SensorId_t sensorId);
+
+// Predict from the latest rotation vector sample.
+// Sets the predicted time and orientation (real, i, j, k).
+// Returns false if there are no samples yet.
+bool predict_latest(uint64_t *pTimestamp_us, float q[4]);
+
+// Replay the samples kept: predict from each rotation vector sample and
+// compare with the orientation actually reported horizon_us later.
+// Returns false if the history is shorter than the horizon.
+bool predict_evaluate(PredictStats_t *pStats);
+
+#endif
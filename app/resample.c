@@ -0,0 +1,219 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-sensor time alignment.
+ */
+
+#include "resample.h"
+
+#include "orient.h"
+#include "samples.h"
+
+// Most records output per resample_service call
+#define MAX_RECORDS_PER_SERVICE (8)
+
+// Inputs, in ResampleRecord_t field order
+enum {
+    INPUT_ACC,
+    INPUT_GYRO,
+    INPUT_ORIENTATION,
+    NUM_INPUTS,
+};
+
+// ------------------------------------------------------------------------
+// Private data
+
+static bool running;
+static sh2_SensorId_t inputs[NUM_INPUTS];
+static uint32_t period_us;
+static uint64_t next_us;        // next grid point, 0 until aligned
+static uint32_t skipped;
+static ResampleHandler_t *pHandler;
+static void *pCookie;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// Get the timestamp and components of sample n (0 or 1) of a slice
+static uint64_t sliceGet(const SampleSlice_t *pSlice, unsigned n, float *pValues)
+{
+    unsigned span = 0;
+
+    if (n >= pSlice->count[0]) {
+        n -= pSlice->count[0];
+        span = 1;
+    }
+    for (unsigned c = 0; c < pSlice->numComponents; c++) {
+        pValues[c] = pSlice->pValue[c][span][n];
+    }
+
+    return pSlice->pTimestamp_us[span][n];
+}
+
+static void lerp(float *pOut, const float *a, const float *b, unsigned len, float f)
+{
+    for (unsigned n = 0; n < len; n++) {
+        pOut[n] = a[n] + (b[n] - a[n]) * f;
+    }
+}
+
+// Interpolate one input at grid point t.
+// Returns 1 if done, 0 if the input has not yet reached t, -1 if t is
+// older than the input's history.
+static int interpolate(unsigned input, uint64_t t, float *pOut, unsigned len)
+{
+    SampleSlice_t slice;
+    float a[SAMPLES_MAX_COMPONENTS];
+    float b[SAMPLES_MAX_COMPONENTS];
+    uint64_t ta, tb;
+    unsigned count = samples_around(inputs[input], t, &slice);
+
+    if (count == 0) {
+        return -1;
+    }
+
+    ta = sliceGet(&slice, 0, a);
+    if (count == 1) {
+        if (ta != t) {
+            // Nothing after t yet
+            return 0;
+        }
+        lerp(pOut, a, a, len, 0.0f);
+        return 1;
+    }
+
+    tb = sliceGet(&slice, 1, b);
+    float f = (float)(t - ta) / (float)(tb - ta);
+    if (input == INPUT_ORIENTATION) {
+        orient_slerp(a, b, f, pOut);
+    }
+    else {
+        lerp(pOut, a, b, len, f);
+    }
+
+    return 1;
+}
+
+// Choose the first grid point: the first multiple of the period at which
+// every input has a sample.  Returns false if an input has none yet.
+static bool align(void)
+{
+    uint64_t start = 0;
+    
+    for (unsigned n = 0; n < NUM_INPUTS; n++) {
+        SampleSlice_t slice;
+        float values[SAMPLES_MAX_COMPONENTS];
+        
+        if (samples_last(inputs[n], SAMPLES_DEPTH, &slice) == 0) {
+            return false;
+        }
+        uint64_t first = sliceGet(&slice, 0, values);
+        if (first > start) {
+            start = first;
+        }
+    }
+
+    next_us = ((start + period_us - 1) / period_us) * period_us;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+bool resample_start(sh2_SensorId_t acc, sh2_SensorId_t gyro, sh2_SensorId_t orientation,
+                    uint32_t period, ResampleHandler_t *handler, void *cookie)
+{
+    resample_stop();
+
+    inputs[INPUT_ACC] = acc;
+    inputs[INPUT_GYRO] = gyro;
+    inputs[INPUT_ORIENTATION] = orientation;
+    for (unsigned n = 0; n < NUM_INPUTS; n++) {
+        if (!samples_track(inputs[n])) {
+            for (unsigned m = 0; m < n; m++) {
+                samples_untrack(inputs[m]);
+            }
+            return false;
+        }
+    }
+
+    period_us = period;
+    next_us = 0;
+    skipped = 0;
+    pHandler = handler;
+    pCookie = cookie;
+    running = true;
+
+    return true;
+}
+
+void resample_stop(void)
+{
+    if (running) {
+        running = false;
+        for (unsigned n = 0; n < NUM_INPUTS; n++) {
+            samples_untrack(inputs[n]);
+        }
+    }
+}
+
+void resample_service(void)
+{
+    ResampleRecord_t record;
+
+    if (!running) {
+        return;
+    }
+    if ((next_us == 0) && !align()) {
+        return;
+    }
+
+    for (unsigned n = 0; n < MAX_RECORDS_PER_SERVICE; n++) {
+        int acc = interpolate(INPUT_ACC, next_us, record.acc, 3);
+        int gyro = interpolate(INPUT_GYRO, next_us, record.gyro, 3);
+        int orientation = interpolate(INPUT_ORIENTATION, next_us, record.orientation, 4);
+
+        if ((acc < 0) || (gyro < 0) || (orientation < 0)) {
+            // Fell out of an input's history: skip ahead to where all
+            // inputs have samples again.
+            uint64_t missed_us = next_us;
+            if (!align()) {
+                // An input has no samples at all: start again when it does
+                next_us = 0;
+                return;
+            }
+            if (next_us > missed_us) {
+                skipped += (uint32_t)((next_us - missed_us) / period_us);
+            }
+            continue;
+        }
+        if ((acc == 0) || (gyro == 0) || (orientation == 0)) {
+            // Wait for all inputs to pass this grid point
+            return;
+        }
+
+        record.timestamp_us = next_us;
+        next_us += period_us;
+        pHandler(pCookie, &record);
+    }
+}
+
+uint32_t resample_skipped(void)
+{
+    return skipped;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-sensor time alignment.
+ *
+ * Accelerometer, gyroscope and rotation vector samples arrive at their own
+ * rates and phases.  This stage resamples them onto a common time grid,
+ * a multiple of the output period, and delivers one fused record per grid
+ * point: vectors by linear interpolation, orientation by SLERP.
+ *
+ * Inputs come from the sample store (samples.h), which resample_start
+ * sets to track the three sensors.  A grid point is output once every
+ * input has a sample at or after it, so the added latency is about one
+ * input interval of the slowest sensor.  Grid points that fall out of the
+ * sample history before that (a stalled sensor) are skipped.
+ */
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sh2.h"
+
+// One fused record
+typedef struct {
+    uint64_t timestamp_us;
+    float acc[3];           // x, y, z
+    float gyro[3];          // x, y, z
+    float orientation[4];   // real, i, j, k
+} ResampleRecord_t;
+
+typedef void (ResampleHandler_t)(void *cookie, const ResampleRecord_t *pRecord);
+
+// Start resampling the given sensors every period_us.
+// acc and gyro are 3-axis sensors, orientation a rotation vector.
+// Returns false if the sensors cannot all be tracked.
+bool resample_start(sh2_SensorId_t acc, sh2_SensorId_t gyro, sh2_SensorId_t orientation,
+                    uint32_t period_us, ResampleHandler_t *handler, void *cookie);
+
+// Stop resampling and stop tracking the sensors.
+void resample_stop(void);
+
+// Output records for grid points that all inputs have passed.
+// Call from the main loop after servicing the sensor hub.
+void resample_service(void);
+
+// Number of grid points skipped since resample_start because an input had
+// no samples.  (The stats command reports it.)
+uint32_t resample_skipped(void);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017-2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * RFC 1662 framing of UART-SHTP transfers.
+ */
+
+#include "rfc1662.h"
+
+// ------------------------------------------------------------------------
+// Public API
+
+// Bytes are stored through a local pointer with no per-byte bounds check;
+// the caller sizes pDst.
+uint32_t rfc1662_encode(uint8_t *pDst, uint8_t protocol, const uint8_t *pSrc, uint32_t len)
+{
+    uint8_t *pStart = pDst;
+    uint8_t c;
+
+    // Start of frame
+    *pDst++ = RFC1662_FLAG;
+
+    // Protocol ID
+    *pDst++ = protocol;
+    
+    // Frame contents
+    for (uint32_t i = 0; i < len; i++) {
+        c = pSrc[i];
+        if ((c == RFC1662_FLAG) || (c == RFC1662_ESCAPE)) {
+            // Store escaped character
+            *pDst++ = RFC1662_ESCAPE;
+            c ^= 0x20;
+        }
+        *pDst++ = c;
+    }
+    
+    // End of frame
+    *pDst++ = RFC1662_FLAG;
+
+    return pDst - pStart;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2017-2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * RFC 1662 framing of UART-SHTP transfers.
+ */
+
+#ifndef RFC1662_H
+#define RFC1662_H
+
+#include <stdint.h>
+
+#define RFC1662_FLAG (0x7e)
+#define RFC1662_ESCAPE (0x7d)
+
+// Worst case encoded frame: two flags, protocol id and every payload byte escaped.
+#define RFC1662_FRAME_MAX(len) (2*(len)+3)
+
+// Form a frame in pDst: flags, protocol id and len bytes of pSrc, escaped.
+// pDst must hold RFC1662_FRAME_MAX(len) bytes.  Returns the frame length.
+uint32_t rfc1662_encode(uint8_t *pDst, uint8_t protocol, const uint8_t *pSrc, uint32_t len);
+
+#endif
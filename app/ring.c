@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Single producer, single consumer byte ring buffer.
+ *
+ * head and tail count bytes and wrap naturally at 2^32.  Each is written
+ * only by its owner.  A data memory barrier orders buffer accesses before
+ * the index update that publishes them to the other side.
+ */
+
+#include "ring.h"
+
+#include <string.h>
+
+#include "stm32f4xx_hal.h"
+
+// ------------------------------------------------------------------------
+// Public API
+
+void ring_init(Ring_t *ring, uint8_t *pBuf, uint32_t size)
+{
+    ring->buffer = pBuf;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+unsigned ring_insert(Ring_t *ring, const uint8_t *pData, unsigned len)
+{
+    uint32_t head = ring->head;
+    unsigned room = ring->mask + 1 - (head - ring->tail);
+    unsigned index = head & ring->mask;
+    unsigned first;
+
+    if (len > room) {
+        len = room;
+    }
+
+    // Copy up to the end of the buffer, then the rest from the start.
+    first = ring->mask + 1 - index;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&ring->buffer[index], pData, first);
+    memcpy(ring->buffer, pData + first, len - first);
+
+    // Data must be in place before the consumer sees the new head.
+    __DMB();
+    ring->head = head + len;
+
+    return len;
+}
+
+unsigned ring_insert1(Ring_t *ring, uint8_t c)
+{
+    uint32_t head = ring->head;
+
+    if ((head - ring->tail) > ring->mask) {
+        return 0;
+    }
+
+    ring->buffer[head & ring->mask] = c;
+    __DMB();
+    ring->head = head + 1;
+
+    return 1;
+}
+
+void ring_unwrite(Ring_t *ring, unsigned len)
+{
+    ring->head -= len;
+}
+
+unsigned ring_remove(Ring_t *ring, uint8_t *pData, unsigned len)
+{
+    uint32_t tail = ring->tail;
+    unsigned avail = ring->head - tail;
+    unsigned index = tail & ring->mask;
+    unsigned first;
+
+    if (len > avail) {
+        len = avail;
+    }
+
+    // Read head before the data it covers.
+    __DMB();
+    
+    first = ring->mask + 1 - index;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(pData, &ring->buffer[index], first);
+    memcpy(pData + first, ring->buffer, len - first);
+
+    // Finish reading before the producer may reuse the space.
+    __DMB();
+    ring->tail = tail + len;
+
+    return len;
+}
+
+unsigned ring_peek(const Ring_t *ring, unsigned offset, uint8_t **ppData)
+{
+    uint32_t start = ring->tail + offset;
+    unsigned avail = ring->head - start;
+    unsigned index = start & ring->mask;
+    unsigned first = ring->mask + 1 - index;
+
+    __DMB();
+
+    *ppData = &ring->buffer[index];
+    if ((int)avail <= 0) {
+        return 0;
+    }
+    
+    return (avail < first) ? avail : first;
+}
+
+uint8_t ring_at(const Ring_t *ring, unsigned offset)
+{
+    return ring->buffer[(ring->tail + offset) & ring->mask];
+}
+
+void ring_consume(Ring_t *ring, unsigned len)
+{
+    __DMB();
+    ring->tail += len;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Single producer, single consumer byte ring buffer.
+ *
+ * One context (e.g. main loop) may insert while another (e.g. an ISR)
+ * removes, without locks.  The buffer size must be a power of 2.
+ * Functions marked "producer" or "consumer" may only be called from
+ * that side.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+typedef struct Ring_s {
+    uint8_t *buffer;
+    uint32_t mask;              // buffer size - 1
+    volatile uint32_t head;     // total bytes inserted (written by producer)
+    volatile uint32_t tail;     // total bytes removed (written by consumer)
+} Ring_t;
+
+// Init a ring using pBuf, of size bytes (a power of 2).
+void ring_init(Ring_t *ring, uint8_t *pBuf, uint32_t size);
+
+// Number of bytes in the ring.
+static inline unsigned ring_used(const Ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+// Number of bytes that can be inserted.
+static inline unsigned ring_free(const Ring_t *ring)
+{
+    return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+// Producer: insert up to len bytes.  Returns the number inserted.
+unsigned ring_insert(Ring_t *ring, const uint8_t *pData, unsigned len);
+
+// Producer: insert one byte.  Returns 1 if inserted, otherwise 0.
+unsigned ring_insert1(Ring_t *ring, uint8_t c);
+
+// Producer: take back the last len bytes inserted.
+// (The caller must ensure the consumer has not started on them.)
+void ring_unwrite(Ring_t *ring, unsigned len);
+
+// Consumer: remove up to len bytes.  Returns the number removed.
+unsigned ring_remove(Ring_t *ring, uint8_t *pData, unsigned len);
+
+// Consumer: get the longest contiguous run of bytes starting offset
+// bytes past the tail.  Sets *ppData to point to it and returns its length.
+// The bytes stay in the ring until released with ring_consume.
+unsigned ring_peek(const Ring_t *ring, unsigned offset, uint8_t **ppData);
+
+// Consumer: read the byte offset bytes past the tail, without removing it.
+uint8_t ring_at(const Ring_t *ring, unsigned offset);
+
+// Consumer: release len bytes at the tail.
+void ring_consume(Ring_t *ring, unsigned len);
+
+#endif
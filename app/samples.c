@@ -0,0 +1,323 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per-sensor sample history.
+ */
+
+#include "samples.h"
+
+// ------------------------------------------------------------------------
+// Private types
+
+typedef struct {
+    sh2_SensorId_t sensorId;
+    uint8_t users;              // samples_track calls not yet undone
+    uint8_t numComponents;
+    uint32_t added;             // samples added, index of next is added % SAMPLES_DEPTH
+    uint64_t timestamp_us[SAMPLES_DEPTH];
+    float value[SAMPLES_MAX_COMPONENTS][SAMPLES_DEPTH];
+} SampleStore_t;
+
+// ------------------------------------------------------------------------
+// Private data
+
+static SampleStore_t store[SAMPLES_MAX_SENSORS];
+
+// Index+1 in store[] for each tracked sensor, 0 if not tracked
+static uint8_t storeIndex[SH2_MAX_SENSOR_ID+1];
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static SampleStore_t *getStore(sh2_SensorId_t sensorId)
+{
+    if ((sensorId > SH2_MAX_SENSOR_ID) || (storeIndex[sensorId] == 0)) {
+        return 0;
+    }
+
+    return &store[storeIndex[sensorId] - 1];
+}
+
+// Extract value components of a sample.  Returns the number of components.
+static unsigned getComponents(const sh2_SensorValue_t *pValue, float *c)
+{
+    switch (pValue->sensorId) {
+        case SH2_RAW_ACCELEROMETER:
+            c[0] = pValue->un.rawAccelerometer.x;
+            c[1] = pValue->un.rawAccelerometer.y;
+            c[2] = pValue->un.rawAccelerometer.z;
+            return 3;
+        case SH2_RAW_GYROSCOPE:
+            c[0] = pValue->un.rawGyroscope.x;
+            c[1] = pValue->un.rawGyroscope.y;
+            c[2] = pValue->un.rawGyroscope.z;
+            return 3;
+        case SH2_RAW_MAGNETOMETER:
+            c[0] = pValue->un.rawMagnetometer.x;
+            c[1] = pValue->un.rawMagnetometer.y;
+            c[2] = pValue->un.rawMagnetometer.z;
+            return 3;
+        case SH2_ACCELEROMETER:
+        case SH2_LINEAR_ACCELERATION:
+        case SH2_GRAVITY:
+            // These share the sh2_Accelerometer_t layout
+            c[0] = pValue->un.accelerometer.x;
+            c[1] = pValue->un.accelerometer.y;
+            c[2] = pValue->un.accelerometer.z;
+            return 3;
+        case SH2_GYROSCOPE_CALIBRATED:
+            c[0] = pValue->un.gyroscope.x;
+            c[1] = pValue->un.gyroscope.y;
+            c[2] = pValue->un.gyroscope.z;
+            return 3;
+        case SH2_GYROSCOPE_UNCALIBRATED:
+            c[0] = pValue->un.gyroscopeUncal.x;
+            c[1] = pValue->un.gyroscopeUncal.y;
+            c[2] = pValue->un.gyroscopeUncal.z;
+            c[3] = pValue->un.gyroscopeUncal.biasX;
+            c[4] = pValue->un.gyroscopeUncal.biasY;
+            c[5] = pValue->un.gyroscopeUncal.biasZ;
+            return 6;
+        case SH2_MAGNETIC_FIELD_CALIBRATED:
+            c[0] = pValue->un.magneticField.x;
+            c[1] = pValue->un.magneticField.y;
+            c[2] = pValue->un.magneticField.z;
+            return 3;
+        case SH2_ROTATION_VECTOR:
+        case SH2_GEOMAGNETIC_ROTATION_VECTOR:
+            // These share the sh2_RotationVectorWAcc_t layout
+            c[0] = pValue->un.rotationVector.real;
+            c[1] = pValue->un.rotationVector.i;
+            c[2] = pValue->un.rotationVector.j;
+            c[3] = pValue->un.rotationVector.k;
+            c[4] = pValue->un.rotationVector.accuracy;
+            return 5;
+        case SH2_GAME_ROTATION_VECTOR:
+            c[0] = pValue->un.gameRotationVector.real;
+            c[1] = pValue->un.gameRotationVector.i;
+            c[2] = pValue->un.gameRotationVector.j;
+            c[3] = pValue->un.gameRotationVector.k;
+            return 4;
+        case SH2_GYRO_INTEGRATED_RV:
+            c[0] = pValue->un.gyroIntegratedRV.real;
+            c[1] = pValue->un.gyroIntegratedRV.i;
+            c[2] = pValue->un.gyroIntegratedRV.j;
+            c[3] = pValue->un.gyroIntegratedRV.k;
+            c[4] = pValue->un.gyroIntegratedRV.angVelX;
+            c[5] = pValue->un.gyroIntegratedRV.angVelY;
+            c[6] = pValue->un.gyroIntegratedRV.angVelZ;
+            return 7;
+        default:
+            return 0;
+    }
+}
+
+// Number of samples held
+static unsigned numHeld(const SampleStore_t *pStore)
+{
+    return (pStore->added < SAMPLES_DEPTH) ? pStore->added : SAMPLES_DEPTH;
+}
+
+// Fill a slice with count samples, starting age samples back from the newest.
+// (age >= count.  An age of count means the slice ends with the newest.)
+static unsigned makeSlice(const SampleStore_t *pStore, unsigned age, unsigned count,
+                          SampleSlice_t *pSlice)
+{
+    unsigned first = (pStore->added - age) & (SAMPLES_DEPTH - 1);
+    unsigned count0 = SAMPLES_DEPTH - first;
+
+    if (count0 > count) {
+        count0 = count;
+    }
+    
+    pSlice->numComponents = pStore->numComponents;
+    pSlice->count[0] = count0;
+    pSlice->count[1] = count - count0;
+    pSlice->pTimestamp_us[0] = &pStore->timestamp_us[first];
+    pSlice->pTimestamp_us[1] = &pStore->timestamp_us[0];
+    for (unsigned c = 0; c < SAMPLES_MAX_COMPONENTS; c++) {
+        pSlice->pValue[c][0] = &pStore->value[c][first];
+        pSlice->pValue[c][1] = &pStore->value[c][0];
+    }
+
+    return count;
+}
+
+// Timestamp of the sample age samples back from the newest (age >= 1)
+static uint64_t timestampAt(const SampleStore_t *pStore, unsigned age)
+{
+    return pStore->timestamp_us[(pStore->added - age) & (SAMPLES_DEPTH - 1)];
+}
+
+// Number of held samples with timestamp >= t.  (samples_add keeps timestamps
+// in order, so this is a binary search.)
+static unsigned countSince(const SampleStore_t *pStore, uint64_t t)
+{
+    unsigned lo = 0;                  // samples known to be >= t
+    unsigned hi = numHeld(pStore);    // upper bound on that count
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi + 1) / 2;
+        if (timestampAt(pStore, mid) >= t) {
+            lo = mid;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    return lo;
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+bool samples_track(sh2_SensorId_t sensorId)
+{
+    if (sensorId > SH2_MAX_SENSOR_ID) {
+        return false;
+    }
+    if (storeIndex[sensorId] != 0) {
+        // Already tracked
+        store[storeIndex[sensorId] - 1].users++;
+        return true;
+    }
+
+    for (unsigned n = 0; n < SAMPLES_MAX_SENSORS; n++) {
+        if (store[n].users == 0) {
+            store[n].sensorId = sensorId;
+            store[n].users = 1;
+            store[n].numComponents = 0;
+            store[n].added = 0;
+            storeIndex[sensorId] = n + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void samples_untrack(sh2_SensorId_t sensorId)
+{
+    SampleStore_t *pStore = getStore(sensorId);
+
+    if (pStore != 0) {
+        pStore->users--;
+        if (pStore->users == 0) {
+            storeIndex[sensorId] = 0;
+        }
+    }
+}
+
+bool samples_isTracked(sh2_SensorId_t sensorId)
+{
+    return getStore(sensorId) != 0;
+}
+
+bool samples_add(const sh2_SensorValue_t *pValue)
+{
+    SampleStore_t *pStore = getStore(pValue->sensorId);
+    float c[SAMPLES_MAX_COMPONENTS];
+    unsigned index;
+
+    if (pStore == 0) {
+        return false;
+    }
+
+    // Keep timestamps in order, for countSince: late samples are dropped.
+    if ((pStore->added != 0) && (pValue->timestamp < timestampAt(pStore, 1))) {
+        return false;
+    }
+
+    index = pStore->added & (SAMPLES_DEPTH - 1);
+    pStore->numComponents = getComponents(pValue, c);
+    pStore->timestamp_us[index] = pValue->timestamp;
+    for (unsigned n = 0; n < pStore->numComponents; n++) {
+        pStore->value[n][index] = c[n];
+    }
+    pStore->added++;
+
+    return true;
+}
+
+unsigned samples_latest(sh2_SensorId_t sensorId, uint64_t *pTimestamp_us, float *pValues)
+{
+    SampleStore_t *pStore = getStore(sensorId);
+    unsigned index;
+
+    if ((pStore == 0) || (pStore->added == 0)) {
+        return 0;
+    }
+
+    index = (pStore->added - 1) & (SAMPLES_DEPTH - 1);
+    *pTimestamp_us = pStore->timestamp_us[index];
+    for (unsigned n = 0; n < pStore->numComponents; n++) {
+        pValues[n] = pStore->value[n][index];
+    }
+
+    return pStore->numComponents;
+}
+
+unsigned samples_last(sh2_SensorId_t sensorId, unsigned n, SampleSlice_t *pSlice)
+{
+    SampleStore_t *pStore = getStore(sensorId);
+
+    if (pStore == 0) {
+        return makeSlice(&store[0], 0, 0, pSlice);
+    }
+    if (n > numHeld(pStore)) {
+        n = numHeld(pStore);
+    }
+
+    return makeSlice(pStore, n, n, pSlice);
+}
+
+unsigned samples_around(sh2_SensorId_t sensorId, uint64_t t_us, SampleSlice_t *pSlice)
+{
+    SampleStore_t *pStore = getStore(sensorId);
+    unsigned after;
+
+    if (pStore == 0) {
+        return makeSlice(&store[0], 0, 0, pSlice);
+    }
+
+    // The sample at or before t is the one older than those after t
+    after = countSince(pStore, t_us + 1);
+    if (after >= numHeld(pStore)) {
+        return makeSlice(pStore, 0, 0, pSlice);
+    }
+
+    return makeSlice(pStore, after + 1, (after > 0) ? 2 : 1, pSlice);
+}
+
+unsigned samples_window(sh2_SensorId_t sensorId, uint64_t from_us, uint64_t to_us,
+                        SampleSlice_t *pSlice)
+{
+    SampleStore_t *pStore = getStore(sensorId);
+    unsigned since;
+    unsigned after;
+
+    if ((pStore == 0) || (to_us <= from_us)) {
+        return makeSlice(&store[0], 0, 0, pSlice);
+    }
+
+    since = countSince(pStore, from_us);
+    after = countSince(pStore, to_us);
+
+    return makeSlice(pStore, since, since - after, pSlice);
+}
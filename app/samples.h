@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per-sensor sample history.
+ *
+ * Recent samples of tracked sensors are kept in rings laid out as
+ * structure of arrays: one array of timestamps and one array per value
+ * component.  Queries return slices pointing into those arrays, so
+ * filters and statistics can run over contiguous floats.
+ *
+ * Components, in order, by sensor type:
+ *   vectors (acc, gyro, mag, ...)     x, y, z
+ *   raw sensors                       x, y, z (ADC units)
+ *   uncalibrated gyro                 x, y, z, bias x, y, z
+ *   rotation vectors                  real, i, j, k [, accuracy]
+ *   gyro integrated RV                real, i, j, k, ang vel x, y, z
+ */
+
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sh2.h"
+#include "sh2_SensorValue.h"
+
+// Number of sensors that can be tracked at once
+#define SAMPLES_MAX_SENSORS (4)
+
+// Samples kept per sensor (a power of 2)
+#define SAMPLES_DEPTH (64)
+
+// Most value components per sample
+#define SAMPLES_MAX_COMPONENTS (7)
+
+// A run of consecutive samples, oldest first.  Because the history is a
+// ring, the run is in at most two contiguous spans: span 0 then span 1.
+typedef struct {
+    unsigned numComponents;
+    unsigned count[2];
+    const uint64_t *pTimestamp_us[2];
+    const float *pValue[SAMPLES_MAX_COMPONENTS][2];
+} SampleSlice_t;
+
+// Start keeping history for a sensor.  Returns false if no slot is free.
+// Calls are counted, so several users can track the same sensor.
+bool samples_track(sh2_SensorId_t sensorId);
+
+// Undo one samples_track call.  When none remain, stop keeping history
+// for the sensor and discard its samples.
+void samples_untrack(sh2_SensorId_t sensorId);
+
+// Returns true if history is kept for a sensor.
+bool samples_isTracked(sh2_SensorId_t sensorId);
+
+// Store a sample of a tracked sensor.  Samples are kept in timestamp order:
+// one older than the newest held (a late event) is dropped.
+// Returns false if the sample was not stored.
+bool samples_add(const sh2_SensorValue_t *pValue);
+
+// Get the latest sample: its timestamp and components.
+// Returns the number of components, or 0 if there is no sample.
+unsigned samples_latest(sh2_SensorId_t sensorId, uint64_t *pTimestamp_us, float *pValues);
+
+// Get up to the last n samples.  Returns the number of samples in the slice.
+unsigned samples_last(sh2_SensorId_t sensorId, unsigned n, SampleSlice_t *pSlice);
+
+// Get the samples either side of time t: the last at or before t, then
+// the next, if any.  Returns the number of samples in the slice: 2, 1 if
+// there is none after t yet, 0 if t is older than the samples kept.
+unsigned samples_around(sh2_SensorId_t sensorId, uint64_t t_us, SampleSlice_t *pSlice);
+
+// Get the samples with from_us <= timestamp < to_us.
+// Returns the number of samples in the slice.
+unsigned samples_window(sh2_SensorId_t sensorId, uint64_t from_us, uint64_t to_us,
+                        SampleSlice_t *pSlice);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sensor report sequence number accounting.
+ */
+
+#include "sequence.h"
+
+// ------------------------------------------------------------------------
+// Public API
+
+void sequence_check(SequenceStats_t *pStats, uint8_t sequence)
+{
+    uint8_t delta;
+
+    if (!pStats->started) {
+        // First report, or the first since a sensor hub reset.  After a
+        // reset, numbers carry on from the next one with these 8 bits.
+        if (pStats->received > 0) {
+            pStats->sequence += 1 + (uint8_t)(sequence - (pStats->sequence + 1));
+        }
+        else {
+            pStats->sequence = sequence;
+        }
+        pStats->started = true;
+        pStats->received++;
+        return;
+    }
+    pStats->received++;
+    delta = sequence - (uint8_t)pStats->sequence;
+
+    if (delta == 0) {
+        pStats->duplicate++;
+    }
+    else if (delta >= 0x100 - SEQUENCE_LATE_WINDOW) {
+        // Just behind the last report: one counted as lost arrived late
+        pStats->late++;
+        if (pStats->lost > 0) {
+            pStats->lost--;
+        }
+    }
+    else {
+        // In order, after delta-1 missing reports
+        pStats->lost += delta - 1;
+        pStats->sequence += delta;
+    }
+}
+
+uint32_t sequence_extend(const SequenceStats_t *pStats, uint8_t sequence)
+{
+    return pStats->sequence - (uint8_t)(pStats->sequence - sequence);
+}
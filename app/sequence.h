@@ -0,0 +1,62 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sensor report sequence number accounting.
+ *
+ * Reports carry an 8-bit sequence number.  Each sensor's numbers are
+ * extended to 32 bits and every report is classified against the last
+ * in-order one:
+ *
+ *   same number                     duplicate
+ *   up to SEQUENCE_LATE_WINDOW back  late (one counted as lost arrived)
+ *   anything else                    in order, after (delta - 1) lost
+ *
+ * So a gap of up to 256 - SEQUENCE_LATE_WINDOW reports is counted as
+ * lost.  A gap of a multiple of 256 can't be seen in 8 bits.
+ */
+
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How far behind the last in-order report a report counts as late
+#define SEQUENCE_LATE_WINDOW (16)
+
+// Sequence number accounting for one sensor.
+// Counts are totals since startup.  Sequence numbers restart after a
+// sensor hub reset: clear started then, and tracking restarts.  The
+// extended numbers carry on past the last one, so they never go back.
+typedef struct {
+    bool started;        // sequence holds the last in-order report
+    uint32_t sequence;   // 8-bit report sequence numbers, extended
+    uint32_t received;   // reports received
+    uint32_t lost;       // reports missing from the sequence
+    uint32_t duplicate;  // reports repeating the last sequence number
+    uint32_t late;       // reports arriving after a later one (out of order)
+} SequenceStats_t;
+
+// Account for a report's 8-bit sequence number.
+void sequence_check(SequenceStats_t *pStats, uint8_t sequence);
+
+// Extend the 8-bit sequence number of a report just checked (in order,
+// a duplicate or late) to 32 bits.
+uint32_t sequence_extend(const SequenceStats_t *pStats, uint8_t sequence);
+
+#endif
@@ -29,4 +29,8 @@ sh2_Hal_t *sh2_hal_init(void);
 sh2_Hal_t *dfu_hal_init(void);
 sh2_Hal_t *fsp200_dfu_hal_init(void);
 
+// Wait until the DFU HAL may have input for read, or timeout_us passes.
+// Returns at once where reads have to be polled.
+void dfu_hal_waitRx(sh2_Hal_t *self, uint32_t timeout_us);
+
 #endif
@@ -24,13 +24,14 @@
 #include "sh2_hal.h"
 #include "sh2_err.h"
 #include "dbg.h"
+#include "timebase.h"
+#include "boot.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 #include "stm32f4xx_hal.h"
-#include "stm32f4xx_hal_tim.h"
 #include "stm32f4xx_hal_spi.h"
 
 #define CLKSEL0_PORT GPIOA
@@ -56,8 +57,13 @@
 #define CSN_PIN  GPIO_PIN_6
 
 // Keep reset asserted this long.
-// (Some targets have a long RC decay on reset.)
+// (Some targets have a long RC decay on reset.  Boards without one can
+// define a shorter time, as measured from the boot timeline.)
+// The hold is fixed: no signal shows when reset has taken effect at the
+// hub.  RSTN is driven push-pull, so its input reads low at once.
+#ifndef RESET_DELAY_US
 #define RESET_DELAY_US (10000)
+#endif
 
 // Wait up to this long to see first interrupt from SH
 #define START_DELAY_US (2000000)
@@ -93,9 +99,6 @@ typedef enum SpiState_e
 // Dummy transmit data for SPI reads
 static const uint8_t txZeros[SH2_HAL_MAX_TRANSFER_IN] = {0};
 
-// Timer handle
-static TIM_HandleTypeDef tim2;
-
 // SPI Peripheral, SPI1
 static SPI_HandleTypeDef spi;
 
@@ -161,24 +164,7 @@ static void csn(bool state)
 
 static uint32_t timeNowUs(void)
 {
-    return __HAL_TIM_GET_COUNTER(&tim2);
-}
-
-static void hal_init_timer(void)
-{
-    __HAL_RCC_TIM2_CLK_ENABLE();
-    
-    // Prescale to get 1 count per uS
-    uint32_t prescaler = (uint32_t)((HAL_RCC_GetPCLK2Freq() / 1000000) - 1);
-
-    tim2.Instance = TIM2;
-    tim2.Init.Period = 0xFFFFFFFF;
-    tim2.Init.Prescaler = prescaler;
-    tim2.Init.ClockDivision = 0;
-    tim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-
-    HAL_TIM_Base_Init(&tim2);
-    HAL_TIM_Base_Start(&tim2);
+    return (uint32_t)timebase_nowUs();
 }
 
 static void hal_init_gpio(void)
@@ -309,7 +295,6 @@ static void hal_init_spi(bool dfu)
 
 static void hal_init_hw(bool dfu)
 {
-    hal_init_timer();
     hal_init_gpio();
     hal_init_spi(dfu);
 }
@@ -485,11 +470,7 @@ void SPI1_IRQHandler(void)
 
 void delayUs(uint32_t delay)
 {
-    volatile uint32_t now = timeNowUs();
-    uint32_t start = now;
-    while ((now - start) < delay) {
-        now = timeNowUs();
-    }
+    timebase_delayUs(delay);
 }
 
 void resetDelayUs(uint32_t delay)
@@ -516,6 +497,7 @@ static int sh2_spi_hal_open(sh2_Hal_t *self)
     }
 
     isOpen = true;
+    boot_mark(BOOT_HAL_OPEN);
 
     // Init hardware (false -> non-DFU config)
     hal_init_hw(false);
@@ -554,12 +536,16 @@ static int sh2_spi_hal_open(sh2_Hal_t *self)
     // Deassert reset, boot in non-DFU mode
     bootn(true);
     rstn(true);
+    boot_mark(BOOT_RESET_RELEASED);
 
     // enable interrupts
     enableInts();
 
     // Wait for INTN to be asserted
     resetDelayUs(START_DELAY_US);
+    if (!inReset) {
+        boot_mark(BOOT_HUB_READY);
+    }
 
     return retval;
 }
@@ -581,9 +567,6 @@ static void sh2_spi_hal_close(sh2_Hal_t *self)
     // Deinit SPI peripheral
     HAL_SPI_DeInit(&spi);
     
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
-
     // No longer open
     isOpen = false;
 }
@@ -743,9 +726,6 @@ static void dfu_spi_hal_close(sh2_Hal_t *self)
     // Deinit SPI peripheral
     HAL_SPI_DeInit(&spi);
     
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
-    
     // No longer open
     isOpen = false;
 }
@@ -861,6 +841,7 @@ sh2_Hal_t *dfu_hal_init(void)
     return &dfuHal;
 }
 
-
-
-    
+void dfu_hal_waitRx(sh2_Hal_t *self, uint32_t timeout_us)
+{
+    // Nothing to wait for: each DFU read is a bus transfer started by read.
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Binary sensor stream over the console UART.
+ */
+
+#include "stream.h"
+
+#include <stdint.h>
+
+#include "console.h"
+
+// Sensor record: id, sequence, up to 10 bytes of varint, report.
+#define MAX_EVENT_RECORD_LEN (2 + 10 + SH2_MAX_SENSOR_EVENT_LEN)
+
+// Longest record of any kind (a text record is the longest)
+#define MAX_RECORD_LEN (2 + STREAM_TEXT_MAX)
+#if MAX_EVENT_RECORD_LEN > MAX_RECORD_LEN
+#error "Sensor records must fit in MAX_RECORD_LEN"
+#endif
+
+// COBS adds one byte per 254 plus the terminating zero.
+#define MAX_FRAME_LEN (MAX_RECORD_LEN + (MAX_RECORD_LEN / 254) + 2)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static uint8_t sequence;
+static uint64_t lastTimestamp_us;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// Zig-zag encode a signed value, so small magnitudes of either sign
+// make small varints.
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+// Store value as an unsigned LEB128 varint.  Returns the number of bytes used.
+static unsigned putVarint(uint8_t *pDst, uint64_t value)
+{
+    unsigned n = 0;
+
+    while (value >= 0x80) {
+        pDst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    pDst[n++] = (uint8_t)value;
+
+    return n;
+}
+
+// COBS encode len bytes from pSrc into pDst, followed by a zero delimiter.
+// Returns the number of bytes stored.
+static unsigned cobsEncode(uint8_t *pDst, const uint8_t *pSrc, unsigned len)
+{
+    unsigned code = 0;   // index of the current code byte
+    unsigned out = 1;    // next output index
+    uint8_t run = 1;     // code value: 1 + non-zero bytes since code byte
+
+    for (unsigned n = 0; n < len; n++) {
+        if (pSrc[n] == 0) {
+            pDst[code] = run;
+            code = out++;
+            run = 1;
+        }
+        else {
+            pDst[out++] = pSrc[n];
+            run++;
+            if (run == 0xFF) {
+                pDst[code] = run;
+                code = out++;
+                run = 1;
+            }
+        }
+    }
+    pDst[code] = run;
+    pDst[out++] = 0;
+
+    return out;
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+void stream_reset(void)
+{
+    sequence = 0;
+    lastTimestamp_us = 0;
+}
+
+bool stream_sendEvent(const sh2_SensorEvent_t *pEvent)
+{
+    uint8_t record[MAX_RECORD_LEN];
+    uint8_t frame[MAX_FRAME_LEN];
+    unsigned len = 0;
+    unsigned reportLen = pEvent->len;
+
+    if (reportLen > SH2_MAX_SENSOR_EVENT_LEN) {
+        reportLen = SH2_MAX_SENSOR_EVENT_LEN;
+    }
+
+    // Form the record
+    record[len++] = pEvent->reportId;
+    record[len++] = sequence;
+    len += putVarint(&record[len], zigzag((int64_t)(pEvent->timestamp_uS - lastTimestamp_us)));
+    for (unsigned n = 0; n < reportLen; n++) {
+        record[len++] = pEvent->report[n];
+    }
+
+    // Sequence advances even if the record is dropped, so the gap shows.
+    sequence++;
+
+    // Frame and send it
+    len = cobsEncode(frame, record, len);
+    if (!console_writeRaw(frame, len)) {
+        // Dropped.  Next record carries the delta from the last one sent.
+        return false;
+    }
+
+    lastTimestamp_us = pEvent->timestamp_uS;
+
+    return true;
+}
+
+bool stream_sendLog(uint16_t msgId, const uint32_t *pArgs, unsigned numArgs)
+{
+    uint8_t record[MAX_RECORD_LEN];
+    uint8_t frame[MAX_FRAME_LEN];
+    unsigned len = 0;
+
+    if (numArgs > (MAX_RECORD_LEN - 4) / 4) {
+        numArgs = (MAX_RECORD_LEN - 4) / 4;
+    }
+
+    // Form the record
+    record[len++] = STREAM_LOG_ID;
+    record[len++] = sequence;
+    record[len++] = (uint8_t)msgId;
+    record[len++] = (uint8_t)(msgId >> 8);
+    for (unsigned n = 0; n < numArgs; n++) {
+        record[len++] = (uint8_t)pArgs[n];
+        record[len++] = (uint8_t)(pArgs[n] >> 8);
+        record[len++] = (uint8_t)(pArgs[n] >> 16);
+        record[len++] = (uint8_t)(pArgs[n] >> 24);
+    }
+
+    // Sequence advances even if the record is dropped, so the gap shows.
+    sequence++;
+
+    // Frame and send it
+    len = cobsEncode(frame, record, len);
+    
+    return console_writeRaw(frame, len);
+}
+
+bool stream_sendText(const uint8_t *pText, unsigned len)
+{
+    uint8_t record[MAX_RECORD_LEN];
+    uint8_t frame[MAX_FRAME_LEN];
+    unsigned chunk;
+    unsigned recordLen;
+    bool sent = true;
+
+    while (len > 0) {
+        chunk = (len < STREAM_TEXT_MAX) ? len : STREAM_TEXT_MAX;
+
+        // Form the record
+        record[0] = STREAM_TEXT_ID;
+        record[1] = sequence;
+        for (unsigned n = 0; n < chunk; n++) {
+            record[2 + n] = pText[n];
+        }
+        recordLen = 2 + chunk;
+
+        // Sequence advances even if the record is dropped, so the gap shows.
+        sequence++;
+
+        // Frame and send it
+        recordLen = cobsEncode(frame, record, recordLen);
+        if (!console_writeRaw(frame, recordLen)) {
+            sent = false;
+        }
+
+        pText += chunk;
+        len -= chunk;
+    }
+
+    return sent;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Binary sensor stream over the console UART.
+ *
+ * Each sensor event is sent as one record, COBS encoded and terminated
+ * by a 0x00 byte.  Decoded, a record contains:
+ *
+ *   byte 0      sensor id (sh2_SensorEvent_t reportId)
+ *   byte 1      stream sequence number, increments by one per record sent
+ *   bytes 2..   timestamp delta in microseconds since the previous sensor
+ *               record sent, as a zig-zag encoded signed LEB128 varint:
+ *               0, -1, 1, -2, ... encode as 0, 1, 2, 3, ...  (Late events
+ *               have negative deltas.  The first record after stream_reset
+ *               carries the full timestamp.)
+ *   remaining   raw sensor report bytes, as received from the hub.  Fields
+ *               are little-endian fixed point values with the Q points
+ *               given in the SH-2 reference manual.
+ *
+ * Log records (see log.h) are sent on the same stream, with sensor id
+ * STREAM_LOG_ID.  Decoded, a log record contains:
+ *
+ *   byte 0      STREAM_LOG_ID
+ *   byte 1      stream sequence number
+ *   bytes 2-3   message id, little-endian: the index of the message in
+ *               log_msgs.h
+ *   remaining   message arguments, 4 bytes each, little-endian
+ *
+ * Text written to stdout while the stream runs (command responses, help)
+ * is sent in text records, with sensor id STREAM_TEXT_ID:
+ *
+ *   byte 0      STREAM_TEXT_ID
+ *   byte 1      stream sequence number
+ *   remaining   up to STREAM_TEXT_MAX characters.  A line may span several
+ *               records; it ends with a newline.
+ *
+ * A gap in the stream sequence number means records were dropped because
+ * the console could not keep up.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+
+#include "sh2.h"
+
+// Record ids used for log and text records.  (Not sensor report ids.)
+#define STREAM_LOG_ID (0xFF)
+#define STREAM_TEXT_ID (0xFE)
+
+// Most characters in one text record
+#define STREAM_TEXT_MAX (64)
+
+// Restart the stream sequence number and timestamp deltas.
+void stream_reset(void);
+
+// Send one sensor event as a binary record.
+// Returns false if the console dropped the record.
+bool stream_sendEvent(const sh2_SensorEvent_t *pEvent);
+
+// Send one log message as a binary record.
+// Returns false if the console dropped the record.
+bool stream_sendLog(uint16_t msgId, const uint32_t *pArgs, unsigned numArgs);
+
+// Send text as one or more text records.
+// Returns false if the console dropped any of them.
+bool stream_sendText(const uint8_t *pText, unsigned len);
+
+#endif
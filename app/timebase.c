@@ -0,0 +1,131 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 64-bit microsecond time base, TIM2 extended by its update interrupt.
+ */
+
+#include "timebase.h"
+
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h"
+
+// Initial TIM2 count.  Define as e.g. 0xFFF00000 to see the first wrap
+// about a second after startup.
+#ifndef TIMEBASE_START_US
+#define TIMEBASE_START_US (0)
+#endif
+
+// ------------------------------------------------------------------------
+// Private data
+
+static TIM_HandleTypeDef tim2;
+static bool running;
+
+// Number of times TIM2 has wrapped: the high 32 bits of the clock
+static volatile uint32_t wraps;
+
+// ------------------------------------------------------------------------
+// Public API
+
+void timebase_init(void)
+{
+    if (running) {
+        return;
+    }
+    
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    
+    // TIM2 is on APB1.  Its clock is PCLK1, doubled if APB1 is divided
+    // down from HCLK.
+    RCC_ClkInitTypeDef clocks;
+    uint32_t latency;
+    uint32_t timClock = HAL_RCC_GetPCLK1Freq();
+
+    HAL_RCC_GetClockConfig(&clocks, &latency);
+    if (clocks.APB1CLKDivider != RCC_HCLK_DIV1) {
+        timClock *= 2;
+    }
+
+    // Prescale to get 1 count per uS
+    uint32_t prescaler = (timClock / 1000000) - 1;
+
+    tim2.Instance = TIM2;
+    tim2.Init.Period = 0xFFFFFFFF;
+    tim2.Init.Prescaler = prescaler;
+    tim2.Init.ClockDivision = 0;
+    tim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+
+    HAL_TIM_Base_Init(&tim2);
+    __HAL_TIM_SET_COUNTER(&tim2, TIMEBASE_START_US);
+
+    // Init raises the update flag, loading the prescaler.  That is not a wrap.
+    __HAL_TIM_CLEAR_FLAG(&tim2, TIM_FLAG_UPDATE);
+    wraps = 0;
+
+    // The wrap handler is short and readers cope with it being held off,
+    // so any priority will do.
+    HAL_NVIC_SetPriority(TIM2_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    
+    HAL_TIM_Base_Start_IT(&tim2);
+    running = true;
+}
+
+uint64_t timebase_nowUs(void)
+{
+    uint32_t high;
+    uint32_t low;
+    bool wrapped;
+
+    // Retry if the wrap interrupt ran while reading
+    do {
+        high = wraps;
+        low = __HAL_TIM_GET_COUNTER(&tim2);
+        wrapped = (__HAL_TIM_GET_FLAG(&tim2, TIM_FLAG_UPDATE) != RESET);
+    } while (high != wraps);
+
+    // A wrap with its interrupt still pending (held off by interrupt
+    // priority or masking) is not yet counted in wraps.  If the flag was
+    // set before the count was read, the count is small.
+    if (wrapped && (low < 0x80000000)) {
+        high++;
+    }
+
+    return ((uint64_t)high << 32) | low;
+}
+
+void timebase_delayUs(uint32_t t)
+{
+    uint32_t start = __HAL_TIM_GET_COUNTER(&tim2);
+
+    while ((__HAL_TIM_GET_COUNTER(&tim2) - start) < t) {
+        // Wait
+    }
+}
+
+// ------------------------------------------------------------------------
+// Interrupt handler
+
+void TIM2_IRQHandler(void)
+{
+    if (__HAL_TIM_GET_FLAG(&tim2, TIM_FLAG_UPDATE) != RESET) {
+        __HAL_TIM_CLEAR_FLAG(&tim2, TIM_FLAG_UPDATE);
+        wraps++;
+    }
+}
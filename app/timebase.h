@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 64-bit microsecond time base.
+ *
+ * TIM2 counts microseconds in 32 bits and wraps every ~71.6 minutes.  Its
+ * update interrupt counts the wraps, extending the count to 64 bits.  The
+ * low 32 bits are the TIM2 count, so 32-bit times taken from this clock
+ * (as passed to the sh2 library) are consistent with it.
+ *
+ * main starts the clock with timebase_init at boot and it then runs
+ * freely.  Sensor hub HALs only read it, so opening and closing them does
+ * not restart it.
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+// Start the clock, if not already running.
+void timebase_init(void);
+
+// Microseconds since the clock started.
+// Lock free, callable from any interrupt priority.
+uint64_t timebase_nowUs(void);
+
+// Busy wait for at least t microseconds.
+void timebase_delayUs(uint32_t t);
+
+#endif
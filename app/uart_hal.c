@@ -22,13 +22,15 @@
 #include "sh2_hal_init.h"
 #include "sh2_hal.h"
 #include "sh2_err.h"
+#include "timebase.h"
+#include "boot.h"
+#include "rfc1662.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 #include "stm32f4xx_hal.h"
-#include "stm32f4xx_hal_tim.h"
 #include "usart.h"
 
 #define SH2_BPS (3000000)            // 3Mbps for UART-SHTP
@@ -58,18 +60,23 @@
 #define INTN_PORT GPIOA
 #define INTN_PIN GPIO_PIN_10
 
-#define RFC1662_FLAG (0x7e)
-#define RFC1662_ESCAPE (0x7d)
-
 #define PROTOCOL_CONTROL (0)
 #define PROTOCOL_SHTP (1)
 
 // Time between transmitted characters
 #define TX_INTERVAL_US (100)
 
+// Largest encoded frame
+#define TX_FRAME_MAX RFC1662_FRAME_MAX(SH2_HAL_MAX_TRANSFER_OUT)
+
 // Keep reset asserted this long.
-// (Some targets have a long RC decay on reset.)
+// (Some targets have a long RC decay on reset.  Boards without one can
+// define a shorter time, as measured from the boot timeline.)
+// The hold is fixed: no signal shows when reset has taken effect at the
+// hub.  RSTN is driven push-pull, so its input reads low at once.
+#ifndef RESET_DELAY_US
 #define RESET_DELAY_US (10000)
+#endif
 
 // Wait up to this long to see first interrupt from SH
 #define START_DELAY_US (2000000)
@@ -101,20 +108,28 @@ static bool isOpen = false;
 // DMA stream for USART1 Rx.
 DMA_HandleTypeDef hdma_usart1_rx;
 
+// DMA stream for USART1 Tx. (Used in DFU mode)
+DMA_HandleTypeDef hdma_usart1_tx;
+
 // USART1 handle
 UART_HandleTypeDef huart1;
 
-// Timer handle
-TIM_HandleTypeDef tim2;
-
 // receive support
 static uint8_t rxBuffer[SH2_HAL_DMA_SIZE]; // receives UART data via DMA (must be a power of 2)
 static uint32_t rxIndex = 0;               // next index to read
 static uint32_t rxTimestamp_uS;            // timestamp of INTN event
-
-// RFC 1622 frame decode area
-static uint8_t rxFrame[SH2_HAL_MAX_TRANSFER_IN];
-static uint32_t rxFrameLen;
+static volatile bool rxArrived;            // DFU input seen since the last dfu_hal_waitRx
+
+// RFC 1622 frame decode.
+// SHTP payloads are decoded directly into the buffer supplied to read.
+// Control protocol (BSN) payloads are decoded into rxCtrl.
+static uint8_t rxCtrl[4];              // payload of control protocol frame
+static uint8_t *rxShtpBuf;             // client buffer for SHTP payloads
+static uint32_t rxShtpBufLen;          // size of rxShtpBuf
+static uint8_t *rxDest;                // destination of frame in progress
+static uint32_t rxDestLen;             // size of rxDest
+static int rxProtocol;                 // protocol id of frame, -1 until seen
+static uint32_t rxFrameLen;            // payload bytes in frame (excluding protocol id)
 static bool rxFrameReady;
 static RxState_t rxState;
 
@@ -122,7 +137,7 @@ static RxState_t rxState;
 static uint32_t lastTxTime = 0;        // uS timestamp of last tx char (for 100uS intervals)
 static uint16_t lastBsn = 0;           // value of last valid BSN
 static volatile TxState_t txState = TX_IDLE;    // transmit state: IDLE, SENDING_BSQ, SENDING_FRAME.
-static uint8_t txFrame[2*SH2_HAL_MAX_TRANSFER_OUT+2]; // frame to be sent. (RFC encode on insert)
+static uint8_t txFrame[TX_FRAME_MAX];  // frame to be sent. (RFC encode on insert)
 static uint32_t txFrameLen;            // len of frame to be sent (after RFC encode).
 // buffer status query message (RFC encoded)
 static const uint8_t bsq[3] = { RFC1662_FLAG, PROTOCOL_CONTROL, RFC1662_FLAG };
@@ -146,6 +161,7 @@ static sh2_Hal_t fsp200DfuHal;
 static void disableInts(void)
 {
     HAL_NVIC_DisableIRQ(EXTI15_10_IRQn);
+    HAL_NVIC_DisableIRQ(DMA2_Stream7_IRQn);
     HAL_NVIC_DisableIRQ(DMA2_Stream2_IRQn);
     HAL_NVIC_DisableIRQ(USART1_IRQn);
 }
@@ -154,6 +170,7 @@ static void enableInts(void)
 {
     HAL_NVIC_EnableIRQ(USART1_IRQn);
     HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+    HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
     HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 }
 
@@ -223,6 +240,8 @@ static void hal_init_dma(void)
     /* DMA interrupt init */
     /* DMA2_Stream2_IRQn interrupt configuration */
     HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
+    /* DMA2_Stream7_IRQn interrupt configuration */
+    HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 5, 0);
 }
 
 static void hal_init_usart(void)
@@ -251,26 +270,8 @@ static void hal_init_usart(void)
     HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
 }
 
-static void hal_init_timer(void)
-{
-    __HAL_RCC_TIM2_CLK_ENABLE();
-    
-    // Prescale to get 1 count per uS
-    uint32_t prescaler = (uint32_t)((HAL_RCC_GetPCLK2Freq() / 1000000) - 1);
-
-    tim2.Instance = TIM2;
-    tim2.Init.Period = 0xFFFFFFFF;
-    tim2.Init.Prescaler = prescaler;
-    tim2.Init.ClockDivision = 0;
-    tim2.Init.CounterMode = TIM_COUNTERMODE_UP;
-
-    HAL_TIM_Base_Init(&tim2);
-    HAL_TIM_Base_Start(&tim2);
-}
-
 static void hal_init_hw(void)
 {
-    hal_init_timer();
     hal_init_gpio();
     hal_init_dma();
     hal_init_usart();
@@ -325,10 +326,26 @@ static int setupUsart(uint32_t baudrate)
         return SH2_ERR_IO;
     }
 
+    hdma_usart1_tx.Instance = DMA2_Stream7;
+    hdma_usart1_tx.Init.Channel = DMA_CHANNEL_4;
+    hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+    {
+        return SH2_ERR_IO;
+    }
+
     // Resync rxIndex with DMA process
     rxIndex = 0;
 
     __HAL_LINKDMA(&huart1,hdmarx,hdma_usart1_rx);
+    __HAL_LINKDMA(&huart1,hdmatx,hdma_usart1_tx);
 
     huart1.Instance = USART1;
     huart1.Init.BaudRate = baudrate;
@@ -349,6 +366,7 @@ static int setupUsart(uint32_t baudrate)
 // reset RFC 1662 decode state machine
 static void rfc1662_reset(void)
 {
+    rxProtocol = -1;
     rxFrameLen = 0;
     rxFrameReady = false;
     rxState = OUTSIDE_FRAME;
@@ -356,15 +374,30 @@ static void rfc1662_reset(void)
 
 static void rxResetFrame(void)
 {
+    rxProtocol = -1;
     rxFrameLen = 0;
     rxFrameReady = false;
 }
 
 static void rxAddToFrame(uint8_t c)
 {
+    // First character is the protocol id, it selects where the payload goes
+    if (rxProtocol < 0) {
+        rxProtocol = c;
+        if (c == PROTOCOL_SHTP) {
+            rxDest = rxShtpBuf;
+            rxDestLen = rxShtpBufLen;
+        }
+        else {
+            rxDest = rxCtrl;
+            rxDestLen = sizeof(rxCtrl);
+        }
+        return;
+    }
+    
     // Add the character to the frame in progress
-    if (rxFrameLen < sizeof(rxFrame)) {
-        rxFrame[rxFrameLen] = c;
+    if (rxFrameLen < rxDestLen) {
+        rxDest[rxFrameLen] = c;
         rxFrameLen++;
     }
     else {
@@ -389,7 +422,7 @@ static void rfc1662_rx(uint8_t c)
         case INSIDE_FRAME:
             // Look for end of frame
             if (c == RFC1662_FLAG) {
-                if (rxFrameLen > 0) {
+                if (rxProtocol >= 0) {
                     // Frame is done
                     rxFrameReady = true;
                     rxState = OUTSIDE_FRAME;
@@ -420,18 +453,12 @@ static void rfc1662_rx(uint8_t c)
 
 static uint32_t timeNowUs(void)
 {
-    return __HAL_TIM_GET_COUNTER(&tim2);
+    return (uint32_t)timebase_nowUs();
 }
 
 static void delay_us(uint32_t t)
 {
-    uint32_t start, now;
-
-    now = timeNowUs();
-    start = now;
-    while ((now - start) < t) {
-        now = timeNowUs();
-    }
+    timebase_delayUs(t);
 }
 
 static void reset_delay_us(uint32_t t)
@@ -489,47 +516,6 @@ static void txStep(void)
     }
 }
 
-static void txStore(uint8_t c)
-{
-    if (txFrameLen < sizeof(txFrame)) {
-        txFrame[txFrameLen] = c;
-    }
-    txFrameLen++;
-}
-
-// Form transmit buffer with flags, PROTOCOL_SHTP id, RFC 1662 encoding.
-// Result ends up in txFrame, txFrameLen.
-// If the process overflows, txFrameLen will be > sizeof(txFrame)
-// but the extra bytes will not be written beyond txFrame[]
-static void txEncode(uint8_t *pSrc, uint32_t len)
-{
-    uint32_t i = 0;
-    txFrameLen = 0;
-
-    // Start of frame
-    txStore(RFC1662_FLAG);
-
-    // Protocol ID
-    txStore(PROTOCOL_SHTP);
-    
-    // Frame contents
-    for (i = 0; i < len; i++) {
-        if ((pSrc[i] == RFC1662_FLAG) ||
-            (pSrc[i] == RFC1662_ESCAPE)) {
-            // Store escaped character
-            txStore(RFC1662_ESCAPE);
-            txStore(pSrc[i] ^ 0x20);
-        }
-        else {
-            // store the character normally
-            txStore(pSrc[i]);
-        }
-    }
-    
-    // End of frame
-    txStore(RFC1662_FLAG);
-}
-
 // ------------------------------------------------------------------------
 // SHTP UART HAL Methods
 
@@ -541,6 +527,9 @@ static int sh2_uart_hal_open_aux(sh2_Hal_t *self, bool dfu)
     }
     
     isOpen = true;
+    if (!dfu) {
+        boot_mark(BOOT_HAL_OPEN);
+    }
     
     // Assert reset
     rstn(false);
@@ -583,9 +572,15 @@ static int sh2_uart_hal_open_aux(sh2_Hal_t *self, bool dfu)
 
     // Deassert reset
     rstn(true);
+    if (!dfu) {
+        boot_mark(BOOT_RESET_RELEASED);
+    }
 
     // Wait for INTN to be asserted
     reset_delay_us(START_DELAY_US);
+    if (!dfu && !inReset) {
+        boot_mark(BOOT_HUB_READY);
+    }
 
     return SH2_OK;
 }
@@ -616,9 +611,6 @@ static void sh2_uart_hal_close(sh2_Hal_t *self)
     // Disable DMA
     __HAL_DMA_DISABLE(&hdma_usart1_rx);
 
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
-
     isOpen = false;
 }
 
@@ -632,18 +624,30 @@ static int sh2_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
     //  * Keep tx data flowing (at 1 char per 100uS.)
     //  * Deliver a whole frame to caller, if one is ready
 
+    // SHTP payloads are decoded straight into pBuffer.  The caller passes the
+    // same buffer until a frame is returned.  If it changes while an SHTP
+    // frame is in progress, that frame is dropped and we resync on the next flag.
+    if ((rxState != OUTSIDE_FRAME) && (rxProtocol == PROTOCOL_SHTP) &&
+        (rxDest != pBuffer)) {
+        rfc1662_reset();
+    }
+    rxShtpBuf = pBuffer;
+    rxShtpBufLen = len;
+
     while ((rxIndex != stopPoint) && !rxFrameReady) {
         rfc1662_rx(rxBuffer[rxIndex]);
         rxIndex = (rxIndex+1) & sizeof(rxBuffer)-1;
 
-        if (rxFrameReady && (rxFrameLen > 0) && (rxFrame[0] == PROTOCOL_CONTROL)) {
-            // Process control protocol (BSN received)
-            lastBsn = (rxFrame[2]<<8) + rxFrame[1];
+        if (rxFrameReady && (rxProtocol != PROTOCOL_SHTP)) {
+            if ((rxProtocol == PROTOCOL_CONTROL) && (rxFrameLen >= 2)) {
+                // Process control protocol (BSN received)
+                lastBsn = (rxCtrl[1]<<8) + rxCtrl[0];
+            
+                bootn(true);  // If bootn was asserted, we can deassert it now.
+            }
 
             // That frame was consumed
             rxFrameReady = false;
-            
-            bootn(true);  // If bootn was asserted, we can deassert it now.
         }
     }
 
@@ -652,16 +656,19 @@ static int sh2_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
     
     // If a frame was assembled, return it
     if (rxFrameReady) {
-        // Set timestamp when returning a frame
-        *t = rxTimestamp_uS;
-        
-        // Copy into pBuffer
-        memcpy(pBuffer, &rxFrame[1], rxFrameLen-1);  // Copy all but first char, protocol id
-        
         // signal that we consumed the frame
         rxFrameReady = false;
 
-        return rxFrameLen-1;
+        if (rxFrameLen > len) {
+            // Frame didn't fit in pBuffer, discard it.
+            return SH2_ERR_BAD_PARAM;
+        }
+
+        // Set timestamp when returning a frame
+        *t = rxTimestamp_uS;
+        
+        // Payload is already in pBuffer
+        return rxFrameLen;
     }
     
     return 0;
@@ -670,7 +677,7 @@ static int sh2_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
 static int sh2_uart_hal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len)
 {
     // Validate parameters
-    if ((pBuffer == 0) || (len == 0)) {
+    if ((pBuffer == 0) || (len == 0) || (len > SH2_HAL_MAX_TRANSFER_OUT)) {
         return SH2_ERR_BAD_PARAM;
     }
 
@@ -680,11 +687,7 @@ static int sh2_uart_hal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len)
     }
 
     // RFC encode the buffer and store in txFrame
-    txEncode(pBuffer, len);
-    if (txFrameLen > sizeof(txFrame)) {
-        // frame overflowed the buffer after encode
-        return SH2_ERR_BAD_PARAM;
-    }
+    txFrameLen = rfc1662_encode(txFrame, PROTOCOL_SHTP, pBuffer, len);
 
     // Reset txIndex 
     txIndex = 0;
@@ -735,8 +738,11 @@ static int dfu_uart_hal_open(sh2_Hal_t *self)
 
     enableInts();
 
-    // Start data flowing
+    // Start data flowing.  The line going idle after a DFU response
+    // signals it has arrived.
+    rxArrived = false;
     HAL_UART_Receive_DMA(&huart1, rxBuffer, sizeof(rxBuffer));
+    __HAL_UART_ENABLE_IT(&huart1, UART_IT_IDLE);
 
     // To boot in SHTP-UART mode, must have PS1=1, PS0=0.
     // PS1 is set via jumper.
@@ -766,13 +772,15 @@ static void dfu_uart_hal_close(sh2_Hal_t *self)
     inReset = true;
     
     // Disable UART
+    __HAL_UART_DISABLE_IT(&huart1, UART_IT_IDLE);
     __HAL_UART_DISABLE(&huart1);
     
     // Disable DMA
     __HAL_DMA_DISABLE(&hdma_usart1_rx);
+    __HAL_DMA_DISABLE(&hdma_usart1_tx);
 
-    // Deinit timer
-    __HAL_TIM_DISABLE(&tim2);
+    // Any transmit in flight was abandoned
+    txState = TX_IDLE;
 
     isOpen = false;
 }
@@ -784,9 +792,9 @@ static int dfu_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
     // Timestamps are zero in DFU mode
     *t = 0;
         
-    // Process data from DMA buffer, moving to rxFrame.
+    // Process data from DMA buffer, moving directly to pBuffer.
     while ((rxIndex != stopPoint) && (rxFrameLen < len)) {
-        rxFrame[rxFrameLen] = rxBuffer[rxIndex];
+        pBuffer[rxFrameLen] = rxBuffer[rxIndex];
         rxFrameLen += 1;
         rxIndex = (rxIndex+1) & sizeof(rxBuffer)-1;
     }
@@ -794,10 +802,7 @@ static int dfu_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
     // Deliver len bytes to caller, if they are ready.
     if (rxFrameLen >= len) {
         
-        // Copy into pBuffer
-        memcpy(pBuffer, &rxFrame, len);  // Copy rxFrame to pBuffer
-        
-        // We consumed that frame, reset rxFrame buffer
+        // We consumed that frame, reset frame length
         rxFrameLen = 0;
 
         // return len to tell caller data is valid
@@ -810,7 +815,7 @@ static int dfu_uart_hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, ui
 static int dfu_uart_hal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len)
 {
     // Validate parameters
-    if ((pBuffer == 0) || (len == 0)) {
+    if ((pBuffer == 0) || (len == 0) || (len > sizeof(txFrame))) {
         return SH2_ERR_BAD_PARAM;
     }
 
@@ -819,13 +824,13 @@ static int dfu_uart_hal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len)
         return 0;
     }
 
-    // Copy the data to transmit
+    // Copy the data to transmit so caller can reuse pBuffer right away
     memcpy(txFrame, pBuffer, len);
     txFrameLen = len;
 
     // Send the data
     txState = TX_SENDING_DFU;
-    HAL_UART_Transmit_IT(&huart1, pBuffer, len);
+    HAL_UART_Transmit_DMA(&huart1, txFrame, len);
 
     return len;
 }
@@ -850,6 +855,13 @@ void HAL_GPIO_EXTI_Callback(uint16_t n)
  */
 void USART1_IRQHandler(void)
 {
+    // Line went idle after DFU input (only enabled in DFU mode)
+    if (__HAL_UART_GET_IT_SOURCE(&huart1, UART_IT_IDLE) &&
+        __HAL_UART_GET_FLAG(&huart1, UART_FLAG_IDLE)) {
+        __HAL_UART_CLEAR_IDLEFLAG(&huart1);
+        rxArrived = true;
+    }
+    
     HAL_UART_IRQHandler(&huart1);
 }
 
@@ -861,6 +873,14 @@ void DMA2_Stream2_IRQHandler(void)
     HAL_DMA_IRQHandler(&hdma_usart1_rx);
 }
 
+/**
+ * @brief This function handles DMA2 stream7 global interrupt.
+ */
+void DMA2_Stream7_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_usart1_tx);
+}
+
 void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
 {
     // Ignore
@@ -898,6 +918,23 @@ sh2_Hal_t *dfu_hal_init(void)
     return &dfuHal;
 }
 
+void dfu_hal_waitRx(sh2_Hal_t *self, uint32_t timeout_us)
+{
+    uint32_t start = timeNowUs();
+
+    // Sleep until the idle line interrupt flags input.  Interrupts are
+    // masked around the check, so one arriving in between still ends the
+    // WFI.  (SysTick ends it every ms, for the timeout.)
+    __disable_irq();
+    while (!rxArrived && ((timeNowUs() - start) < timeout_us)) {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    rxArrived = false;
+    __enable_irq();
+}
+
 sh2_Hal_t *fsp200_dfu_hal_init(void)
 {
     fsp200DfuHal.open = fsp200_dfu_uart_hal_open;
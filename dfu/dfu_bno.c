@@ -40,13 +40,18 @@
 
 static int sendAppSize(sh2_Hal_t *pHal, uint32_t appSize);
 static int sendPktSize(sh2_Hal_t *pHal, uint8_t packetLen);
-static int sendPkt(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len);
+static int preparePkt(uint8_t *pPkt, uint32_t offset, uint32_t len);
+static int dfuWrite(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len);
+static int dfuAwaitAck(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len);
 
 // --- Private Data -------------------------------------------------------
 
 uint8_t dfuBuff[MAX_PACKET_LEN + 2];
 uint32_t totalRetries;
 
+// Firmware packets (with CRC).  One is in flight while the next is prepared.
+static uint8_t dfuPkt[2][MAX_PACKET_LEN + 2];
+
 sh2_Hal_t *pDfuHal = 0;
 
 // --- Public API ---------------------------------------------------------
@@ -58,6 +63,8 @@ int dfu(void)
     uint32_t appLen = 0;
     uint8_t packetLen = 0;
     uint32_t offset = 0;
+    uint32_t toSend = 0;
+    int cur = 0;
     const char * s = 0;
     sh2_Hal_t *pHal = 0;
 
@@ -126,28 +133,46 @@ int dfu(void)
         goto close_and_return;
     }
     
-    // Send firmware image
+    // Send firmware image.
+    // Each packet is read from hcbin and its CRC computed while the
+    // previous packet is being transmitted and acknowledged.
     offset = 0;
+    toSend = (appLen < packetLen) ? appLen : packetLen;
+    status = preparePkt(dfuPkt[cur], offset, toSend);
+    if (status != SH2_OK) {
+        goto close_and_return;
+    }
     while (offset < appLen) {
-        uint32_t toSend = appLen - offset;
-        if (toSend > packetLen) {
-            toSend = packetLen;
+        uint32_t nextOffset = offset + toSend;
+        uint32_t nextLen = appLen - nextOffset;
+        if (nextLen > packetLen) {
+            nextLen = packetLen;
         }
 
-        // Extract this packet's content from hcbin
-        status = firmware.getAppData(dfuBuff, offset, toSend);
+        // Start transmitting this packet
+        status = dfuWrite(pHal, dfuPkt[cur], toSend+2);  // plus 2 for CRC
         if (status != SH2_OK) {
             goto close_and_return;
         }
-        
-        // Send this packet's contents
-        status = sendPkt(pHal, dfuBuff, toSend);
+
+        // Prepare the next one while this one is in flight
+        if (nextLen > 0) {
+            status = preparePkt(dfuPkt[!cur], nextOffset, nextLen);
+            if (status != SH2_OK) {
+                goto close_and_return;
+            }
+        }
+
+        // Wait for this packet to be acknowledged
+        status = dfuAwaitAck(pHal, dfuPkt[cur], toSend+2);
         if (status != SH2_OK) {
             goto close_and_return;
         }
 
         // update loop variables
-        offset += toSend;
+        offset = nextOffset;
+        toSend = nextLen;
+        cur = !cur;
     }
 
 close_and_return:
@@ -212,7 +237,30 @@ static void appendCrc(uint8_t *packet, uint8_t len)
 #define DFU_SEND_TIMEOUT_US (100000)
 
 // I/O Utility functions
-static int dfuSend(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
+
+// Start a write, waiting for the HAL to accept it.
+static int dfuWrite(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
+{
+    int status = 0;
+    uint32_t now = pHal->getTimeUs(pHal);
+    uint32_t start = now;
+        
+    while ((status == 0) && ((now - start) < DFU_SEND_TIMEOUT_US))
+    {
+        status = pHal->write(pHal, pData, len);
+        now = pHal->getTimeUs(pHal);
+    }
+    if (status == 0)
+    {
+        // recognize timeout as an error.
+        status = SH2_ERR_TIMEOUT;
+    }
+
+    return (status > 0) ? SH2_OK : status;
+}
+
+// Wait for the ACK of a packet already written, resending it as needed.
+static int dfuAwaitAck(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
 {
     unsigned int retries = 0;
     int status = SH2_OK;
@@ -223,26 +271,22 @@ static int dfuSend(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
     while (!gotAck && (retries < DFU_MAX_ATTEMPTS)) {
         uint32_t now = pHal->getTimeUs(pHal);
         uint32_t start = now;
-        
-        // Do write
-        status = 0;
-        while ((status == 0) && ((now - start) < DFU_SEND_TIMEOUT_US))
-        {
-            status = pHal->write(pHal, pData, len);
-            now = pHal->getTimeUs(pHal);
-        }
-        if (status == 0)
+
+        // Resend the packet if the last attempt failed
+        status = SH2_OK;
+        if (retries > 0)
         {
-            // recognize timeout as an error.
-            status = SH2_ERR_TIMEOUT;
+            status = dfuWrite(pHal, pData, len);
         }
-
-        // If write succeeded, read ack
-        if (status > 0)
+        
+        // If write succeeded, read ack.
+        // Between reads, wait for the HAL to signal input.
+        if (status == SH2_OK)
         {
-            status = 0;
+            status = pHal->read(pHal, &ack, 1, &t);
             while ((status == 0) && ((now - start) < DFU_SEND_TIMEOUT_US))
             {
+                dfu_hal_waitRx(pHal, DFU_SEND_TIMEOUT_US - (now - start));
                 status = pHal->read(pHal, &ack, 1, &t);
                 now = pHal->getTimeUs(pHal);
             }
@@ -252,7 +296,6 @@ static int dfuSend(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
                 status = SH2_ERR_TIMEOUT;
             }
         }
-
         
         // If read succeeded, check for ACK
         if (status > 0)
@@ -287,6 +330,18 @@ static int dfuSend(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
     return status;
 }
 
+// Send a packet and wait for its ACK
+static int dfuSend(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
+{
+    int status = dfuWrite(pHal, pData, len);
+    if (status != SH2_OK)
+    {
+        return status;
+    }
+
+    return dfuAwaitAck(pHal, pData, len);
+}
+
 static int sendAppSize(sh2_Hal_t *pHal, uint32_t appSize)
 {
     write32be(dfuBuff, appSize);
@@ -303,11 +358,15 @@ static int sendPktSize(sh2_Hal_t *pHal, uint8_t packetLen)
     return dfuSend(pHal, dfuBuff, 3);
 }
 
-static int sendPkt(sh2_Hal_t *pHal, uint8_t* pData, uint32_t len)
+// Read a packet's content from hcbin and append its CRC
+static int preparePkt(uint8_t *pPkt, uint32_t offset, uint32_t len)
 {
-    memcpy(dfuBuff, pData, len);
-    appendCrc(dfuBuff, len);
-    
-    return dfuSend(pHal, dfuBuff, len+2);  // plus 2 for CRC
+    int status = firmware.getAppData(pPkt, offset, len);
+    if (status != SH2_OK) {
+        return status;
+    }
+    appendCrc(pPkt, len);
+
+    return SH2_OK;
 }
 
@@ -26,7 +26,10 @@
 // Declare external init functions
 // (rather than include files for a single declaration)
 extern void console_init(void);
+extern void console_service(void);
+extern void log_service(void);
 extern void dbg_init(void);
+extern void timebase_init(void);
 
 // Set up interrupt priorities in NVIC
 static void nvic_init(void)
@@ -100,6 +103,9 @@ int main(void)
     // Configure the system clock
     SystemClock_Config();
 
+    // Start the microsecond clock
+    timebase_init();
+
     // Initialize debug pin
     dbg_init();
 
@@ -111,6 +117,8 @@ int main(void)
   
     // Enter main loop, run the demo app service function.
     while (1) {
+        console_service();
         demo_service();
+        log_service();
     }
 }
@@ -0,0 +1,40 @@
+# Keep double precision math out of app/.
+#
+# The Cortex-M4F FPU is single precision, so double math is emulated in
+# software.  Every app source is compiled (syntax only) with implicit
+# float to double promotion and lossy float conversions as errors.  Float
+# arguments to printf must be cast to double explicitly.
+#
+#   cmake -DCC=<gcc or clang> -DROOT=<repo> -DSTUBS=<test/stubs> -P check_single_precision.cmake
+
+file(GLOB sources ${ROOT}/app/*.c)
+
+# Target headers first: the stand-ins only fill in for the sh2 library
+# when its submodule is not checked out.
+set(flags
+    -fsyntax-only -std=gnu99
+    -Werror=double-promotion -Werror=float-conversion
+    -DSTM32F411xE -DUSE_HAL_DRIVER -DARM_MATH_CM4
+    -I${ROOT}/main
+    -I${ROOT}/Drivers/STM32F4xx_HAL_Driver/Inc
+    -I${ROOT}/Drivers/CMSIS/Include
+    -I${ROOT}/Drivers/CMSIS/Device/ST/STM32F4xx/Include
+    -I${ROOT}/app
+    -I${ROOT}/dfu
+    -I${ROOT}/sh2
+    -I${STUBS})
+
+set(failed "")
+foreach(source ${sources})
+    execute_process(COMMAND ${CC} ${flags} ${source}
+                    RESULT_VARIABLE result
+                    ERROR_VARIABLE output)
+    if(NOT result EQUAL 0)
+        message("${output}")
+        list(APPEND failed ${source})
+    endif()
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "Double precision math in: ${failed}")
+endif()
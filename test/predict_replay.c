@@ -0,0 +1,309 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * predict_replay: orientation prediction accuracy and cost over a
+ * recorded DSF log.
+ *
+ *   predict_replay [-r <sensor id>] [-h <horizon ms>] log.dsf
+ *
+ * The log is the demo's dsf output, or sh2stream's output for a binary
+ * capture.  Its records are replayed through the firmware's sample
+ * history and predictor (app/samples.c, app/predict.c).  Each rotation
+ * vector sample (sensor id -r: 5 rv, 8 grv, 42 girv; default girv) is
+ * predicted horizon ms ahead (default 20) and compared with the
+ * orientation logged at that time, interpolated between the records
+ * either side.  Angular velocity comes from the GIRV records, the only
+ * DSF records that carry it, so the log must include girv.
+ *
+ * Reports mean and maximum prediction error, the error of holding the
+ * latest sample instead, and host time per prediction.  (predict_evaluate
+ * gives the cycle count on target, over the last SAMPLES_DEPTH samples.)
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "orient.h"
+#include "predict.h"
+#include "samples.h"
+
+#define MAX_LINE_LEN (256)
+
+// Predictions waiting for the log to reach their time
+#define MAX_PENDING (1024)
+
+#define PI (3.14159265f)
+
+// ------------------------------------------------------------------------
+// Private data
+
+typedef struct {
+    uint64_t t_us;       // predicted time
+    float predicted[4];
+    float held[4];       // sample predicted from
+} Pending_t;
+
+static Pending_t pending[MAX_PENDING];
+static unsigned pendingIn;
+static unsigned pendingOut;
+
+static sh2_SensorId_t rvId = SH2_GYRO_INTEGRATED_RV;
+
+static unsigned count;
+static unsigned dropped;
+static float sumError;
+static float maxError;
+static float sumHoldError;
+static double predictTime;
+static unsigned predictions;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// The predictor reads the target's cycle counter; the host times with
+// its own clock instead.
+uint32_t dbg_cycles(void)
+{
+    return 0;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float degrees(float rad)
+{
+    return rad * 180.0f / PI;
+}
+
+// Parse a DSF record: ".<id> <s>.<us>[, <sample id>], <values>..."
+// Returns false for other lines and records not used here.
+static bool parseRecord(const char *line, sh2_SensorValue_t *pValue)
+{
+    unsigned long long s, us;
+    float v[7];
+    unsigned numValues;
+    int id;
+    char *p;
+
+    if ((line[0] != '.') || (sscanf(line, ".%d %llu.%6llu", &id, &s, &us) != 3)) {
+        return false;
+    }
+    memset(pValue, 0, sizeof(*pValue));
+    pValue->sensorId = (uint8_t)id;
+    pValue->timestamp = s * 1000000u + us;
+
+    switch (id) {
+        case SH2_ROTATION_VECTOR:
+            numValues = 6;      // sample id, real, i, j, k, accuracy
+            break;
+        case SH2_GAME_ROTATION_VECTOR:
+            numValues = 5;      // sample id, real, i, j, k
+            break;
+        case SH2_GYRO_INTEGRATED_RV:
+            numValues = 7;      // ang vel x, y, z, real, i, j, k
+            break;
+        default:
+            return false;
+    }
+
+    p = strchr(line, ',');
+    for (unsigned n = 0; n < numValues; n++) {
+        if (p == 0) {
+            return false;
+        }
+        v[n] = strtof(p + 1, &p);
+        p = strchr(p, ',');
+    }
+
+    switch (id) {
+        case SH2_ROTATION_VECTOR:
+            pValue->un.rotationVector.real = v[1];
+            pValue->un.rotationVector.i = v[2];
+            pValue->un.rotationVector.j = v[3];
+            pValue->un.rotationVector.k = v[4];
+            pValue->un.rotationVector.accuracy = v[5];
+            break;
+        case SH2_GAME_ROTATION_VECTOR:
+            pValue->un.gameRotationVector.real = v[1];
+            pValue->un.gameRotationVector.i = v[2];
+            pValue->un.gameRotationVector.j = v[3];
+            pValue->un.gameRotationVector.k = v[4];
+            break;
+        case SH2_GYRO_INTEGRATED_RV:
+            pValue->un.gyroIntegratedRV.angVelX = v[0];
+            pValue->un.gyroIntegratedRV.angVelY = v[1];
+            pValue->un.gyroIntegratedRV.angVelZ = v[2];
+            pValue->un.gyroIntegratedRV.real = v[3];
+            pValue->un.gyroIntegratedRV.i = v[4];
+            pValue->un.gyroIntegratedRV.j = v[5];
+            pValue->un.gyroIntegratedRV.k = v[6];
+            break;
+    }
+
+    return true;
+}
+
+// Check the pending predictions the log has now passed, so there are
+// records either side of their time
+static void checkPending(uint64_t newest_us)
+{
+    while ((pendingOut != pendingIn) && (pending[pendingOut].t_us < newest_us)) {
+        const Pending_t *pP = &pending[pendingOut];
+        SampleSlice_t around;
+        float before[4], after[4], actual[4];
+
+        pendingOut = (pendingOut + 1) % MAX_PENDING;
+
+        if (samples_around(rvId, pP->t_us, &around) < 2) {
+            // Older than the history kept
+            dropped++;
+            continue;
+        }
+        unsigned s1 = (around.count[0] > 1) ? 0 : 1;
+        unsigned i1 = (around.count[0] > 1) ? 1 : 0;
+        uint64_t tBefore = around.pTimestamp_us[0][0];
+        uint64_t tAfter = around.pTimestamp_us[s1][i1];
+        for (unsigned c = 0; c < 4; c++) {
+            before[c] = around.pValue[c][0][0];
+            after[c] = around.pValue[c][s1][i1];
+        }
+        orient_slerp(before, after,
+                     (float)(pP->t_us - tBefore) / (float)(tAfter - tBefore), actual);
+
+        float error = orient_angle(pP->predicted, actual);
+        sumError += error;
+        sumHoldError += orient_angle(pP->held, actual);
+        if (error > maxError) {
+            maxError = error;
+        }
+        count++;
+    }
+}
+
+// Predict from the rotation vector sample just added
+static void predictLatest(void)
+{
+    Pending_t *pP = &pending[pendingIn];
+    float values[SAMPLES_MAX_COMPONENTS];
+    uint64_t t;
+    double start;
+    bool ok;
+
+    if ((pendingIn + 1) % MAX_PENDING == pendingOut) {
+        // Horizon too long for the queue
+        dropped++;
+        return;
+    }
+    samples_latest(rvId, &t, values);
+    memcpy(pP->held, values, sizeof(pP->held));
+
+    start = now();
+    ok = predict_latest(&pP->t_us, pP->predicted);
+    predictTime += now() - start;
+
+    if (ok) {
+        predictions++;
+        pendingIn = (pendingIn + 1) % MAX_PENDING;
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-r <sensor id>] [-h <horizon ms>] log.dsf\n", name);
+}
+
+// ------------------------------------------------------------------------
+// Main
+
+int main(int argc, char *argv[])
+{
+    char line[MAX_LINE_LEN];
+    unsigned horizon_ms = 20;
+    const char *path = 0;
+    FILE *in;
+
+    for (int n = 1; n < argc; n++) {
+        if ((strcmp(argv[n], "-r") == 0) && (n + 1 < argc)) {
+            rvId = (sh2_SensorId_t)atoi(argv[++n]);
+        }
+        else if ((strcmp(argv[n], "-h") == 0) && (n + 1 < argc)) {
+            horizon_ms = (unsigned)atoi(argv[++n]);
+        }
+        else if ((argv[n][0] != '-') && (path == 0)) {
+            path = argv[n];
+        }
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    in = fopen(path, "r");
+    if (in == 0) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return 1;
+    }
+    if ((rvId != SH2_ROTATION_VECTOR) && (rvId != SH2_GAME_ROTATION_VECTOR) &&
+        (rvId != SH2_GYRO_INTEGRATED_RV)) {
+        fprintf(stderr, "Sensor %d: not a rotation vector with a DSF format\n", rvId);
+        return 2;
+    }
+    if (!predict_start(rvId, SH2_GYRO_INTEGRATED_RV, horizon_ms * 1000u)) {
+        fprintf(stderr, "Can't start the predictor\n");
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in) != 0) {
+        sh2_SensorValue_t value;
+
+        if (!parseRecord(line, &value) || !samples_add(&value)) {
+            continue;
+        }
+        if (value.sensorId == rvId) {
+            checkPending(value.timestamp);
+            predictLatest();
+        }
+    }
+    fclose(in);
+
+    if (count == 0) {
+        fprintf(stderr, "No predictions checked: does the log have girv and sensor %d?\n",
+                rvId);
+        return 1;
+    }
+    printf("Sensor %d, horizon %u ms: %u predictions checked, %u dropped\n",
+           rvId, horizon_ms, count, dropped);
+    printf("  error (deg): mean %.3f, max %.3f; holding the latest sample: mean %.3f\n",
+           degrees(sumError / (float)count), degrees(maxError),
+           degrees(sumHoldError / (float)count));
+    printf("  host time per prediction: %.0f ns\n", predictTime / predictions * 1e9);
+
+    return 0;
+}
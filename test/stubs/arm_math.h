@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the CMSIS-DSP basic math functions used by app/orient.c.
+ * Plain loops, with the same results as the target library.
+ */
+
+#ifndef ARM_MATH_H
+#define ARM_MATH_H
+
+#include <stdint.h>
+
+typedef float float32_t;
+
+static inline void arm_mult_f32(float32_t *pA, float32_t *pB, float32_t *pDst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        pDst[i] = pA[i] * pB[i];
+    }
+}
+
+static inline void arm_add_f32(float32_t *pA, float32_t *pB, float32_t *pDst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        pDst[i] = pA[i] + pB[i];
+    }
+}
+
+static inline void arm_sub_f32(float32_t *pA, float32_t *pB, float32_t *pDst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        pDst[i] = pA[i] - pB[i];
+    }
+}
+
+static inline void arm_scale_f32(float32_t *pSrc, float32_t scale, float32_t *pDst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        pDst[i] = pSrc[i] * scale;
+    }
+}
+
+static inline void arm_offset_f32(float32_t *pSrc, float32_t offset, float32_t *pDst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        pDst[i] = pSrc[i] + offset;
+    }
+}
+
+#endif
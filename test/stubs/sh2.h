@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the sh2 library header: the parts of the API the app
+ * uses, as the library declares them.  (Used when the sh2 submodule is not
+ * checked out, and by the host tests.)
+ */
+
+#ifndef SH2_H
+#define SH2_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sh2_hal.h"
+
+typedef struct sh2_ProductId_s {
+    uint8_t resetCause;
+    uint8_t swVersionMajor;
+    uint8_t swVersionMinor;
+    uint32_t swPartNumber;
+    uint32_t swBuildNumber;
+    uint16_t swVersionPatch;
+    uint8_t reserved0;
+    uint8_t reserved1;
+} sh2_ProductId_t;
+
+#define SH2_MAX_PROD_ID_ENTRIES (5)
+typedef struct sh2_ProductIds_s {
+    sh2_ProductId_t entry[SH2_MAX_PROD_ID_ENTRIES];
+    uint8_t numEntries;
+} sh2_ProductIds_t;
+
+enum sh2_SensorId_e {
+    SH2_RAW_ACCELEROMETER = 0x14,
+    SH2_ACCELEROMETER = 0x01,
+    SH2_LINEAR_ACCELERATION = 0x04,
+    SH2_GRAVITY = 0x06,
+    SH2_RAW_GYROSCOPE = 0x15,
+    SH2_GYROSCOPE_CALIBRATED = 0x02,
+    SH2_GYROSCOPE_UNCALIBRATED = 0x07,
+    SH2_RAW_MAGNETOMETER = 0x16,
+    SH2_MAGNETIC_FIELD_CALIBRATED = 0x03,
+    SH2_MAGNETIC_FIELD_UNCALIBRATED = 0x0f,
+    SH2_ROTATION_VECTOR = 0x05,
+    SH2_GAME_ROTATION_VECTOR = 0x08,
+    SH2_GEOMAGNETIC_ROTATION_VECTOR = 0x09,
+    SH2_PRESSURE = 0x0a,
+    SH2_AMBIENT_LIGHT = 0x0b,
+    SH2_HUMIDITY = 0x0c,
+    SH2_PROXIMITY = 0x0d,
+    SH2_TEMPERATURE = 0x0e,
+    SH2_TAP_DETECTOR = 0x10,
+    SH2_STEP_DETECTOR = 0x18,
+    SH2_STEP_COUNTER = 0x11,
+    SH2_SIGNIFICANT_MOTION = 0x12,
+    SH2_STABILITY_CLASSIFIER = 0x13,
+    SH2_SHAKE_DETECTOR = 0x19,
+    SH2_FLIP_DETECTOR = 0x1a,
+    SH2_PICKUP_DETECTOR = 0x1b,
+    SH2_STABILITY_DETECTOR = 0x1c,
+    SH2_PERSONAL_ACTIVITY_CLASSIFIER = 0x1e,
+    SH2_SLEEP_DETECTOR = 0x1f,
+    SH2_TILT_DETECTOR = 0x20,
+    SH2_POCKET_DETECTOR = 0x21,
+    SH2_CIRCLE_DETECTOR = 0x22,
+    SH2_HEART_RATE_MONITOR = 0x23,
+    SH2_ARVR_STABILIZED_RV = 0x28,
+    SH2_ARVR_STABILIZED_GRV = 0x29,
+    SH2_GYRO_INTEGRATED_RV = 0x2A,
+    SH2_IZRO_MOTION_REQUEST = 0x2B,
+
+    // UPDATE to reflect greatest sensor id
+    SH2_MAX_SENSOR_ID = 0x2B,
+};
+typedef uint8_t sh2_SensorId_t;
+
+typedef struct sh2_SensorConfig {
+    bool changeSensitivityEnabled;
+    bool changeSensitivityRelative;
+    bool wakeupEnabled;
+    bool alwaysOnEnabled;
+    uint16_t changeSensitivity;
+    uint32_t reportInterval_us;
+    uint32_t batchInterval_us;
+    uint32_t sensorSpecific;
+} sh2_SensorConfig_t;
+
+#define SH2_MAX_SENSOR_EVENT_LEN (16)
+typedef struct sh2_SensorEvent {
+    uint64_t timestamp_uS;
+    uint8_t len;
+    uint8_t reportId;
+    uint8_t report[SH2_MAX_SENSOR_EVENT_LEN];
+} sh2_SensorEvent_t;
+
+typedef void (sh2_SensorCallback_t)(void * cookie, sh2_SensorEvent_t *pEvent);
+
+enum sh2_ShtpEvent_e {
+    SH2_SHTP_TX_DISCARD = 0,
+    SH2_SHTP_SHORT_FRAGMENT = 1,
+    SH2_SHTP_TOO_LARGE_PAYLOADS = 2,
+    SH2_SHTP_BAD_RX_CHAN = 3,
+    SH2_SHTP_BAD_TX_CHAN = 4,
+};
+typedef uint8_t sh2_ShtpEvent_t;
+
+typedef struct sh2_SensorConfigResp_e {
+    sh2_SensorId_t sensorId;
+    sh2_SensorConfig_t sensorConfig;
+} sh2_SensorConfigResp_t;
+
+typedef enum sh2_AsyncEventId_e {
+    SH2_RESET,
+    SH2_SHTP_EVENT,
+    SH2_GET_FEATURE_RESP,
+} sh2_AsyncEventId_t;
+
+typedef struct sh2_AsyncEvent {
+    uint32_t eventId;
+    union {
+        sh2_ShtpEvent_t shtpEvent;
+        sh2_SensorConfigResp_t sh2SensorConfigResp;
+    };
+} sh2_AsyncEvent_t;
+
+typedef void (sh2_EventCallback_t)(void * cookie, sh2_AsyncEvent_t *pEvent);
+
+typedef uint8_t sh2_CalStatus_t;
+#define SH2_CAL_SUCCESS (0)
+
+int sh2_open(sh2_Hal_t *pHal, sh2_EventCallback_t *eventCallback, void *eventCookie);
+void sh2_close(void);
+void sh2_service(void);
+int sh2_setSensorCallback(sh2_SensorCallback_t *callback, void *cookie);
+int sh2_devReset(void);
+int sh2_devOn(void);
+int sh2_devSleep(void);
+int sh2_getProdIds(sh2_ProductIds_t *prodIds);
+int sh2_getSensorConfig(sh2_SensorId_t sensorId, sh2_SensorConfig_t *config);
+int sh2_setSensorConfig(sh2_SensorId_t sensorId, const sh2_SensorConfig_t *pConfig);
+int sh2_startCal(uint32_t interval_us);
+int sh2_finishCal(sh2_CalStatus_t *status);
+int sh2_flush(sh2_SensorId_t sensorId);
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the sh2 library's decoded sensor values.
+ */
+
+#ifndef SH2_SENSORVALUE_H
+#define SH2_SENSORVALUE_H
+
+#include <stdint.h>
+
+#include "sh2.h"
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint32_t timestamp;
+} sh2_RawAccelerometer_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} sh2_Accelerometer_t;
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    int16_t temperature;
+    uint32_t timestamp;
+} sh2_RawGyroscope_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} sh2_Gyroscope_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+    float biasX;
+    float biasY;
+    float biasZ;
+} sh2_GyroscopeUncalibrated_t;
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint32_t timestamp;
+} sh2_RawMagnetometer_t;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} sh2_MagneticField_t;
+
+typedef struct {
+    float i;
+    float j;
+    float k;
+    float real;
+    float accuracy;
+} sh2_RotationVectorWAcc_t;
+
+typedef struct {
+    float i;
+    float j;
+    float k;
+    float real;
+} sh2_RotationVector_t;
+
+typedef struct {
+    float i;
+    float j;
+    float k;
+    float real;
+    float angVelX;
+    float angVelY;
+    float angVelZ;
+} sh2_GyroIntegratedRV_t;
+
+typedef struct sh2_SensorValue {
+    uint8_t sensorId;
+    uint8_t sequence;
+    uint8_t status;
+    uint64_t timestamp;
+    uint32_t delay;
+    union {
+        sh2_RawAccelerometer_t rawAccelerometer;
+        sh2_Accelerometer_t accelerometer;
+        sh2_Accelerometer_t linearAcceleration;
+        sh2_Accelerometer_t gravity;
+        sh2_RawGyroscope_t rawGyroscope;
+        sh2_Gyroscope_t gyroscope;
+        sh2_GyroscopeUncalibrated_t gyroscopeUncal;
+        sh2_RawMagnetometer_t rawMagnetometer;
+        sh2_MagneticField_t magneticField;
+        sh2_RotationVectorWAcc_t rotationVector;
+        sh2_RotationVector_t gameRotationVector;
+        sh2_RotationVectorWAcc_t geoMagRotationVector;
+        sh2_GyroIntegratedRV_t gyroIntegratedRV;
+    } un;
+} sh2_SensorValue_t;
+
+int sh2_decodeSensorEvent(sh2_SensorValue_t *value, const sh2_SensorEvent_t *event);
+
+#endif
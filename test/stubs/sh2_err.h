@@ -0,0 +1,33 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the sh2 library's error codes.
+ */
+
+#ifndef SH2_ERR_H
+#define SH2_ERR_H
+
+#define SH2_OK                 (0)
+#define SH2_ERR                (-1)
+#define SH2_ERR_BAD_PARAM      (-2)
+#define SH2_ERR_OP_IN_PROGRESS (-3)
+#define SH2_ERR_IO             (-4)
+#define SH2_ERR_HUB            (-5)
+#define SH2_ERR_TIMEOUT        (-6)
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the sh2 library's HAL interface.
+ */
+
+#ifndef SH2_HAL_H
+#define SH2_HAL_H
+
+#include <stdint.h>
+
+#define SH2_HAL_MAX_TRANSFER_OUT (128)
+#define SH2_HAL_MAX_PAYLOAD_OUT  (128)
+#define SH2_HAL_MAX_TRANSFER_IN  (1024)
+#define SH2_HAL_MAX_PAYLOAD_IN   (1024)
+#define SH2_HAL_DMA_SIZE         (512)
+
+typedef struct sh2_Hal_s sh2_Hal_t;
+
+struct sh2_Hal_s {
+    int (*open)(sh2_Hal_t *self);
+    void (*close)(sh2_Hal_t *self);
+    int (*read)(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us);
+    int (*write)(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len);
+    uint32_t (*getTimeUs)(sh2_Hal_t *self);
+};
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host test stand-in for the STM32 HAL: what the app modules under test
+ * use.  Timer, UART and DMA register access goes to functions the test
+ * provides, so it can simulate the peripherals and interrupts.
+ */
+
+#ifndef STM32F4XX_HAL_H
+#define STM32F4XX_HAL_H
+
+#include <stdint.h>
+
+// Full barrier, as DMB is on the target
+#define __DMB() __sync_synchronize()
+
+#define RESET (0)
+
+typedef enum {
+    DMA1_Stream5_IRQn = 16,
+    DMA1_Stream6_IRQn = 17,
+    TIM2_IRQn = 28,
+    USART2_IRQn = 38,
+} IRQn_Type;
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preemptPriority, uint32_t subPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+uint32_t HAL_GetTick(void);
+
+// Clocks
+typedef struct {
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_HCLK_DIV1 (0x00000000)
+#define RCC_HCLK_DIV2 (0x00001000)
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *clocks, uint32_t *pLatency);
+
+// Timer
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    void *Instance;
+    TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+#define TIM2 ((void *)0)
+#define TIM_COUNTERMODE_UP (0)
+#define TIM_FLAG_UPDATE (1)
+
+#define __HAL_RCC_TIM2_CLK_ENABLE() do { } while (0)
+
+int HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+int HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+
+// Provided by the test
+uint32_t stub_timGetCounter(void);
+void stub_timSetCounter(uint32_t count);
+uint32_t stub_timGetFlag(void);
+void stub_timClearFlag(void);
+
+#define __HAL_TIM_GET_COUNTER(htim) stub_timGetCounter()
+#define __HAL_TIM_SET_COUNTER(htim, count) stub_timSetCounter(count)
+#define __HAL_TIM_GET_FLAG(htim, flag) stub_timGetFlag()
+#define __HAL_TIM_CLEAR_FLAG(htim, flag) stub_timClearFlag()
+
+// GPIO
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIOA ((void *)0)
+#define GPIO_PIN_2 (0x0004)
+#define GPIO_PIN_3 (0x0008)
+#define GPIO_MODE_AF_PP (2)
+#define GPIO_PULLUP (1)
+#define GPIO_SPEED_FREQ_VERY_HIGH (3)
+#define GPIO_AF7_USART2 (7)
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE() do { } while (0)
+
+void HAL_GPIO_Init(void *port, GPIO_InitTypeDef *init);
+
+// DMA
+typedef enum {
+    HAL_DMA_STATE_RESET,
+    HAL_DMA_STATE_READY,
+    HAL_DMA_STATE_BUSY,
+} HAL_DMA_StateTypeDef;
+
+typedef struct {
+    uint32_t Channel;
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+    uint32_t FIFOMode;
+} DMA_InitTypeDef;
+
+typedef struct {
+    void *Instance;
+    DMA_InitTypeDef Init;
+    volatile HAL_DMA_StateTypeDef State;
+    void *Parent;
+} DMA_HandleTypeDef;
+
+#define DMA1_Stream5 ((void *)5)
+#define DMA1_Stream6 ((void *)6)
+#define DMA_CHANNEL_4 (4)
+#define DMA_PERIPH_TO_MEMORY (0)
+#define DMA_MEMORY_TO_PERIPH (1)
+#define DMA_PINC_DISABLE (0)
+#define DMA_MINC_ENABLE (1)
+#define DMA_PDATAALIGN_BYTE (0)
+#define DMA_MDATAALIGN_BYTE (0)
+#define DMA_NORMAL (0)
+#define DMA_CIRCULAR (1)
+#define DMA_PRIORITY_LOW (0)
+#define DMA_FIFOMODE_DISABLE (0)
+
+#define __HAL_RCC_DMA1_CLK_ENABLE() do { } while (0)
+
+int HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+// UART
+typedef enum {
+    HAL_UART_STATE_RESET,
+    HAL_UART_STATE_READY,
+    HAL_UART_STATE_BUSY_RX,
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct {
+    void *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_UART_StateTypeDef RxState;
+} UART_HandleTypeDef;
+
+#define USART2 ((void *)2)
+#define UART_WORDLENGTH_8B (0)
+#define UART_STOPBITS_1 (0)
+#define UART_PARITY_NONE (0)
+#define UART_MODE_TX_RX (3)
+#define UART_HWCONTROL_NONE (0)
+#define UART_OVERSAMPLING_16 (0)
+#define UART_FLAG_IDLE (0x10)
+#define UART_FLAG_TC (0x40)
+#define UART_IT_IDLE (0x10)
+
+#define __HAL_RCC_USART2_CLK_ENABLE() do { } while (0)
+
+#define __HAL_LINKDMA(handle, field, dma) \
+    do { (handle)->field = &(dma); (dma).Parent = (handle); } while (0)
+
+int HAL_UART_Init(UART_HandleTypeDef *huart);
+int HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t size);
+int HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t size);
+int HAL_UART_DMAStop(UART_HandleTypeDef *huart);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+
+// Provided by the test
+uint32_t stub_dmaGetCounter(DMA_HandleTypeDef *hdma);
+uint32_t stub_uartGetFlag(UART_HandleTypeDef *huart, uint32_t flag);
+void stub_uartClearFlag(UART_HandleTypeDef *huart, uint32_t flag);
+
+#define __HAL_DMA_GET_COUNTER(hdma) stub_dmaGetCounter(hdma)
+#define __HAL_UART_GET_FLAG(huart, flag) stub_uartGetFlag((huart), (flag))
+#define __HAL_UART_CLEAR_IDLEFLAG(huart) stub_uartClearFlag((huart), UART_FLAG_IDLE)
+#define __HAL_UART_ENABLE_IT(huart, it) do { } while (0)
+
+#endif
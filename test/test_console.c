@@ -0,0 +1,564 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Console output under each full buffer policy.
+ *
+ * The transmit DMA is simulated by a periodic signal, which preempts the
+ * writer as the DMA and USART2 interrupts do on the target, and is held
+ * off while they are disabled.  It sends a few bytes per tick, much slower
+ * than the writer, so the ring fills.  Lines are written with putchar and
+ * with __write calls split at arbitrary points, and bursts of binary
+ * records holding '\n' bytes with console_writeRaw between them.  Every line and record
+ * must arrive intact or be counted as dropped, exactly once.
+ *
+ * Input is simulated too, to check getchar never waits for it.  Last, the
+ * cost of queueing a line is timed for __write and for the per-byte
+ * putchar loop it replaced.
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "console.h"
+#include "dbg.h"
+#include "log.h"
+#include "usart.h"
+#include "test.h"
+
+// Simulated transmit rate
+#define TICK_US (50)
+#define BYTES_PER_TICK (16)
+
+// Output written under each policy
+#define LINES (3000)
+#define RAW_EVERY (5)               // lines between bursts of binary records
+#define RAW_BURST (4)               // records in a burst
+#define RECORDS (((LINES + RAW_EVERY - 1) / RAW_EVERY) * RAW_BURST)
+#define LINE_MAX (80)
+#define RAW_LEN (24)
+#define RAW_START (0x00)            // first byte of a record, never in text
+
+#define OUT_MAX (LINES * (LINE_MAX + 2) + RECORDS * RAW_LEN)
+
+// Lines queued by each write path in the timing comparison, in batches
+// that fit the transmit buffer
+#define BATCH_LINES (16)
+#define TIMED_BATCHES (20000)
+
+size_t __write(int Handle, const unsigned char *Buf, size_t Bufsize);
+void USART2_IRQHandler(void);
+
+// The console's putchar.  (Called by address: the C library may inline its
+// own.)
+static int (* volatile consolePutchar)(int c) = putchar;
+
+// ------------------------------------------------------------------------
+// Private data
+
+// Transmit in flight
+static UART_HandleTypeDef *pTxUart;
+static CpltCallback_t *txCplt;
+static volatile sig_atomic_t txBusy;
+static uint8_t *pTx;
+static unsigned txLen;
+static unsigned txSent;
+static uint8_t txCopy[256];          // longer than any span
+static unsigned clobbered;          // spans changed while being sent
+
+// Receive DMA
+static uint8_t *pRx;
+static unsigned rxSize;
+static unsigned rxIn;
+static bool rxIdle;
+
+// Interrupt masking
+static volatile sig_atomic_t irqMask;     // USART2 and DMA1 stream 6 disabled
+static volatile sig_atomic_t irqPending;  // tick while masked
+
+// What was sent
+static uint8_t out[OUT_MAX];
+static volatile unsigned outLen;
+
+// ------------------------------------------------------------------------
+// Simulated hardware
+
+static unsigned irqBit(IRQn_Type irq)
+{
+    return (irq == USART2_IRQn) ? 1 : (irq == DMA1_Stream6_IRQn) ? 2 : 0;
+}
+
+// One tick of the transmitter, in interrupt context
+static void txTick(void)
+{
+    if (!txBusy) {
+        return;
+    }
+    txSent += BYTES_PER_TICK;
+    if (txSent < txLen) {
+        return;
+    }
+
+    if (memcmp(pTx, txCopy, txLen) != 0) {
+        clobbered++;
+    }
+    if (outLen + txLen <= sizeof(out)) {
+        memcpy(&out[outLen], pTx, txLen);
+        outLen += txLen;
+    }
+    txBusy = false;
+    txCplt(pTxUart);
+}
+
+static void onTick(int sig)
+{
+    (void)sig;
+    if (irqMask != 0) {
+        irqPending = true;
+    }
+    else {
+        txTick();
+    }
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preemptPriority, uint32_t subPriority)
+{
+    (void)irq;
+    (void)preemptPriority;
+    (void)subPriority;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type irq)
+{
+    irqMask |= irqBit(irq);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq)
+{
+    irqMask &= ~irqBit(irq);
+    if ((irqMask == 0) && irqPending) {
+        // Taken as soon as it is unmasked
+        irqPending = false;
+        raise(SIGALRM);
+    }
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return 42000000;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return 0;
+}
+
+void HAL_GPIO_Init(void *port, GPIO_InitTypeDef *init)
+{
+    (void)port;
+    (void)init;
+}
+
+int HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    hdma->State = HAL_DMA_STATE_READY;
+    return 0;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+}
+
+int HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    huart->RxState = HAL_UART_STATE_READY;
+    return 0;
+}
+
+int HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t size)
+{
+    pTxUart = huart;
+    pTx = pData;
+    txLen = size;
+    txSent = 0;
+    memcpy(txCopy, pData, size);
+    txBusy = true;
+    return 0;
+}
+
+int HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t size)
+{
+    pRx = pData;
+    rxSize = size;
+    rxIn = 0;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return 0;
+}
+
+int HAL_UART_DMAStop(UART_HandleTypeDef *huart)
+{
+    huart->RxState = HAL_UART_STATE_READY;
+    return 0;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+// Only the receive DMA counter is read
+uint32_t stub_dmaGetCounter(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return rxSize - rxIn;
+}
+
+uint32_t stub_uartGetFlag(UART_HandleTypeDef *huart, uint32_t flag)
+{
+    (void)huart;
+    if (flag == UART_FLAG_IDLE) {
+        return rxIdle;
+    }
+    return (flag == UART_FLAG_TC) ? !txBusy : 0;
+}
+
+void stub_uartClearFlag(UART_HandleTypeDef *huart, uint32_t flag)
+{
+    (void)huart;
+    if (flag == UART_FLAG_IDLE) {
+        rxIdle = false;
+    }
+}
+
+// Characters arrive, then the line goes idle
+static void receive(const char *pText)
+{
+    while (*pText != 0) {
+        pRx[rxIn] = (uint8_t)*pText++;
+        rxIn = (rxIn + 1) % rxSize;
+    }
+    rxIdle = true;
+    USART2_IRQHandler();
+}
+
+void usartRegisterHandlers(UART_HandleTypeDef *huart,
+                           CpltCallback_t *rxCplt, CpltCallback_t *txCpltCallback)
+{
+    (void)huart;
+    (void)rxCplt;
+    txCplt = txCpltCallback;
+}
+
+uint32_t dbg_cycles(void)
+{
+    return 0;
+}
+
+void log_msg(LogMsgId_t id, ...)
+{
+    (void)id;
+}
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// Text of line n, with its newline.  Returns its length.
+static unsigned makeLine(char *p, unsigned n)
+{
+    unsigned len = sprintf(p, "line %05u ", n);
+    unsigned fill = (n * 37) % (LINE_MAX - len - 1);
+
+    for (unsigned i = 0; i < fill; i++) {
+        p[len++] = 'a' + (n + i) % 26;
+    }
+    p[len++] = '\n';
+
+    return len;
+}
+
+// Binary record n, full of bytes that look like line endings
+static void makeRecord(uint8_t *p, unsigned n)
+{
+    p[0] = RAW_START;
+    p[1] = (uint8_t)(n >> 8);
+    p[2] = (uint8_t)n;
+    for (unsigned i = 3; i < RAW_LEN; i++) {
+        p[i] = (i % 3 == 0) ? '\n' : (i % 3 == 1) ? '\r' : (uint8_t)(n + i);
+    }
+}
+
+static void startTicks(void)
+{
+    struct itimerval tick = { { 0, TICK_US }, { 0, TICK_US } };
+
+    signal(SIGALRM, onTick);
+    setitimer(ITIMER_REAL, &tick, 0);
+}
+
+static void stopTicks(void)
+{
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+
+    setitimer(ITIMER_REAL, &off, 0);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Finish every transmit at once, with the ticks stopped
+static void flush(void)
+{
+    while (txBusy) {
+        txSent = txLen;
+        txTick();
+    }
+}
+
+// Wait for the transmitter to finish everything queued
+static void drain(void)
+{
+    unsigned idle = 0;
+    struct timespec wait = { 0, 1000000 };
+
+    while (idle < 10) {
+        idle = txBusy ? 0 : (idle + 1);
+        nanosleep(&wait, 0);
+    }
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testPolicy(ConsolePolicy_t policy, const char *name)
+{
+    static char text[LINES * LINE_MAX];
+    unsigned lineStart[LINES + 1];
+    unsigned delivered[LINES] = { 0 };
+    unsigned truncated[LINES] = { 0 };
+    char expect[LINE_MAX + 1];
+    uint8_t record[RAW_LEN];
+    ConsoleStats_t before, after;
+    unsigned textLen = 0;
+    unsigned linesOut = 0, recordsOut = 0, bad = 0;
+    int lastLine = -1, lastRecord = -1;
+    unsigned droppedLines, droppedRecords;
+
+    // The text of all the lines, written in pieces of random length
+    for (unsigned n = 0; n < LINES; n++) {
+        lineStart[n] = textLen;
+        textLen += makeLine(&text[textLen], n);
+    }
+    lineStart[LINES] = textLen;
+
+    srand(policy + 1);
+    drain();
+    outLen = 0;
+    clobbered = 0;
+    console_getStats(&before);
+    console_setPolicy(policy);
+
+    for (unsigned n = 0, pos = 0; n < LINES; n += RAW_EVERY) {
+        unsigned end = lineStart[(n + RAW_EVERY < LINES) ? n + RAW_EVERY : LINES];
+
+        while (pos < end) {
+            unsigned len = 1 + rand() % 100;
+            if (len > end - pos) {
+                len = end - pos;
+            }
+            if (rand() % 3 == 0) {
+                for (unsigned i = 0; i < len; i++) {
+                    consolePutchar(text[pos + i]);
+                }
+            }
+            else {
+                __write(1, (const unsigned char *)&text[pos], len);
+            }
+            pos += len;
+        }
+
+        for (unsigned r = 0; r < RAW_BURST; r++) {
+            makeRecord(record, (n / RAW_EVERY) * RAW_BURST + r);
+            console_writeRaw(record, sizeof(record));
+        }
+    }
+
+    drain();
+    console_getStats(&after);
+    droppedLines = after.droppedLines - before.droppedLines;
+    droppedRecords = after.droppedRecords - before.droppedRecords;
+
+    // Take apart what was sent: records and CR LF terminated lines
+    for (unsigned i = 0; i < outLen; ) {
+        if (out[i] == RAW_START) {
+            unsigned n = ((unsigned)out[i+1] << 8) | out[i+2];
+            makeRecord(record, n);
+            if ((i + RAW_LEN > outLen) || ((int)n <= lastRecord) ||
+                (memcmp(&out[i], record, RAW_LEN) != 0)) {
+                bad++;
+                break;
+            }
+            lastRecord = n;
+            recordsOut++;
+            i += RAW_LEN;
+            continue;
+        }
+
+        uint8_t *pEnd = memchr(&out[i], '\r', outLen - i);
+        unsigned n;
+        if ((pEnd == 0) || (pEnd + 1 >= &out[outLen]) || (pEnd[1] != '\n')) {
+            bad++;
+            break;
+        }
+        unsigned len = pEnd - &out[i];
+        if ((len >= 10) && (sscanf((const char *)&out[i], "line %05u ", &n) == 1) &&
+            (n < LINES)) {
+            unsigned expectLen = makeLine(expect, n) - 1;
+            if ((len == expectLen) && (memcmp(&out[i], expect, len) == 0) &&
+                ((int)n > lastLine)) {
+                delivered[n]++;
+                lastLine = n;
+                linesOut++;
+            }
+            else if ((len < expectLen) && (memcmp(&out[i], expect, len) == 0)) {
+                // The start of a line dropped while it was being sent
+                truncated[n]++;
+            }
+            else {
+                bad++;
+            }
+        }
+        else if (memcmp(&out[i], "line ", (len < 5) ? len : 5) != 0) {
+            bad++;
+        }
+        i += len + 2;
+    }
+
+    for (unsigned n = 0; n < LINES; n++) {
+        if ((delivered[n] + truncated[n]) > 1) {
+            bad++;
+        }
+    }
+
+    printf("Console %s: %u of %u lines sent, %u dropped; "
+           "%u of %u records sent, %u dropped\n",
+           name, linesOut, LINES, droppedLines, recordsOut, RECORDS, droppedRecords);
+
+    CHECK(bad == 0);
+    CHECK(clobbered == 0);
+    CHECK(linesOut + droppedLines == LINES);
+    CHECK(recordsOut + droppedRecords == RECORDS);
+    if (policy == CONSOLE_BLOCK) {
+        CHECK(droppedLines == 0);
+        CHECK(droppedRecords == 0);
+        CHECK(after.droppedBytes == before.droppedBytes);
+    }
+    else {
+        // The transmitter is far too slow to keep up
+        CHECK(droppedLines > 0);
+    }
+}
+
+// getchar returns what has been received, and doesn't wait for more
+static void testGetchar(void)
+{
+    int (* volatile consoleGetchar)(void) = getchar;
+
+    CHECK(consoleGetchar() == EOF);
+
+    receive("ok\r");
+    CHECK(consoleGetchar() == 'o');
+    CHECK(consoleGetchar() == 'k');
+    CHECK(consoleGetchar() == '\n');
+    CHECK(consoleGetchar() == EOF);
+    CHECK(consoleGetchar() == EOF);
+
+    // Echoed
+    drain();
+    CHECK((outLen >= 4) && (memcmp(&out[outLen - 4], "ok\r\n", 4) == 0));
+}
+
+// Time queueing a rotation vector line with the per-byte putchar loop
+// __write used to run, and with __write as it is.  Batches of lines that
+// fit the transmit buffer are timed, and sent between batches, so nothing
+// waits for the transmitter.
+static void testThroughput(void)
+{
+    static const char line[] =
+        "  12.3456 Rotation Vector: r:0.9990 i:0.0120 j:-0.0340 k:0.0010 (acc: 3.2000 deg)\n";
+    const unsigned len = sizeof(line) - 1;
+    double putcharTime = 0, writeTime = 0, start;
+    unsigned sent;
+
+    stopTicks();
+    flush();
+    console_setPolicy(CONSOLE_BLOCK);
+    outLen = 0;
+
+    for (unsigned batch = 0; batch < TIMED_BATCHES; batch++) {
+        start = now();
+        for (unsigned n = 0; n < BATCH_LINES; n++) {
+            for (unsigned i = 0; i < len; i++) {
+                consolePutchar(line[i]);
+            }
+        }
+        putcharTime += now() - start;
+        flush();
+
+        start = now();
+        for (unsigned n = 0; n < BATCH_LINES; n++) {
+            __write(1, (const unsigned char *)line, len);
+        }
+        writeTime += now() - start;
+        flush();
+
+        // Keep the output buffer from filling
+        sent = outLen;
+        outLen = 0;
+    }
+
+    // Both sent every line, with CR LF
+    CHECK(sent == 2 * BATCH_LINES * (len + 1));
+
+    printf("Console ns/line, %u bytes: __write %.1f, putchar loop %.1f\n",
+           len,
+           writeTime / (TIMED_BATCHES * BATCH_LINES) * 1e9,
+           putcharTime / (TIMED_BATCHES * BATCH_LINES) * 1e9);
+}
+
+int main(void)
+{
+    console_init();
+    startTicks();
+
+    testPolicy(CONSOLE_BLOCK, "block");
+    testPolicy(CONSOLE_DROP_NEWEST, "drop newest");
+    testPolicy(CONSOLE_DROP_OLDEST, "drop oldest");
+    testGetchar();
+    testThroughput();
+
+    return TEST_RESULT();
+}
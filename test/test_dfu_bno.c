@@ -0,0 +1,413 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * BNO DFU against a simulated bootloader on a 115200 bps UART.
+ *
+ * Time is simulated.  Bytes take their time on the wire, the bootloader
+ * takes a while to write each packet to flash before it ACKs, and reading
+ * a packet from the firmware image and computing its CRC takes time too.
+ * The HAL keeps a pointer to each packet written and checks it is left
+ * alone until the last byte is sent, as the DMA transmit needs.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "dfu.h"
+#include "firmware-bno.h"
+#include "sh2_err.h"
+#include "sh2_hal_init.h"
+#include "test.h"
+
+#define BPS (115200)
+
+// Time on the wire for n bytes (start, 8 data and stop bits each)
+#define WIRE_US(n) (((n) * 10u * 1000000u + BPS - 1) / BPS)
+
+// Bootloader time to write a packet to flash before sending the ACK
+#define FLASH_US (200)
+
+// Target time to read a packet from the image and compute its CRC
+#define PREP_US (300)
+
+// Firmware image
+#define APP_LEN (10000)
+#define PACKET_LEN (64)
+#define PACKETS ((APP_LEN + PACKET_LEN - 1) / PACKET_LEN)
+
+// Pause after DFU in dfu_bno.c
+#define DELAY_POST_DFU_US (10000)
+
+#define ACK ('s')
+#define NAK ('n')
+
+extern uint32_t totalRetries;
+
+// ------------------------------------------------------------------------
+// Private data
+
+static uint8_t image[APP_LEN];
+
+// Simulated time, advanced a little at each HAL clock read
+static uint32_t now_us;
+
+// Transmit in flight
+static bool txBusy;
+static uint32_t txDone_us;
+static const uint8_t *pTx;
+static uint8_t txCopy[PACKET_LEN + 2];
+static unsigned txLen;
+
+// Response from the bootloader
+static bool ackPending;
+static uint32_t ack_us;
+static uint8_t ackByte;
+
+// Bootloader state
+static enum { RX_APP_SIZE, RX_PACKET_SIZE, RX_DATA } blState;
+static uint32_t blAppLen;
+static uint32_t blPacketLen;
+static uint32_t blOffset;
+static uint8_t blImage[APP_LEN];
+static unsigned blPacket;       // data packets received, including bad ones
+static unsigned blCorruptMask;  // packets (by number received, < 32) to corrupt
+static bool blMute;             // send no responses
+
+// Checks on the DFU side
+static unsigned clobbered;      // packets changed while being sent
+static unsigned reads;
+static uint32_t nextAppOffset;
+static bool appDataInOrder;
+static uint32_t open_us, close_us;
+
+static sh2_Hal_t hal;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static uint16_t crc16(const uint8_t *p, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (uint32_t n = 0; n < len; n++) {
+        crc ^= (uint16_t)p[n] << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool crcOk(const uint8_t *p, uint32_t len)
+{
+    uint16_t crc = crc16(p, len - 2);
+
+    return (p[len-2] == (crc >> 8)) && (p[len-1] == (crc & 0xFF));
+}
+
+static void respond(uint8_t c)
+{
+    if (!blMute) {
+        ackPending = true;
+        ackByte = c;
+        ack_us = txDone_us + FLASH_US + WIRE_US(1);
+    }
+}
+
+// The bootloader receives the transmit in flight
+static void bootloaderReceive(void)
+{
+    uint8_t p[PACKET_LEN + 2];
+    bool ok;
+
+    txBusy = false;
+    if (memcmp(pTx, txCopy, txLen) != 0) {
+        clobbered++;
+    }
+    memcpy(p, pTx, txLen);
+
+    switch (blState) {
+        case RX_APP_SIZE:
+            ok = (txLen == 6) && crcOk(p, txLen);
+            if (ok) {
+                blAppLen = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                           ((uint32_t)p[2] << 8) | p[3];
+                blState = RX_PACKET_SIZE;
+            }
+            break;
+        case RX_PACKET_SIZE:
+            ok = (txLen == 3) && crcOk(p, txLen);
+            if (ok) {
+                blPacketLen = p[0];
+                blState = RX_DATA;
+            }
+            break;
+        case RX_DATA:
+        default:
+            if ((blPacket < 32) && (blCorruptMask & (1u << blPacket))) {
+                p[0] ^= 0x01;
+            }
+            blPacket++;
+            uint32_t expect = blAppLen - blOffset;
+            if (expect > blPacketLen) {
+                expect = blPacketLen;
+            }
+            ok = (txLen == expect + 2) && crcOk(p, txLen);
+            if (ok) {
+                memcpy(&blImage[blOffset], p, expect);
+                blOffset += expect;
+            }
+            break;
+    }
+    respond(ok ? ACK : NAK);
+}
+
+static void simRun(void)
+{
+    if (txBusy && ((int32_t)(now_us - txDone_us) >= 0)) {
+        bootloaderReceive();
+    }
+}
+
+static void reset(unsigned corruptMask, bool mute)
+{
+    now_us = 0;
+    txBusy = false;
+    ackPending = false;
+    blState = RX_APP_SIZE;
+    blOffset = 0;
+    blPacket = 0;
+    blCorruptMask = corruptMask;
+    blMute = mute;
+    memset(blImage, 0, sizeof(blImage));
+    clobbered = 0;
+    reads = 0;
+    totalRetries = 0;
+}
+
+// Time for one exchange with no delays on the DFU side
+static uint32_t exchangeUs(unsigned len)
+{
+    return WIRE_US(len) + FLASH_US + WIRE_US(1);
+}
+
+// ------------------------------------------------------------------------
+// Simulated DFU HAL
+
+static int halOpen(sh2_Hal_t *self)
+{
+    open_us = now_us;
+    return SH2_OK;
+}
+
+static void halClose(sh2_Hal_t *self)
+{
+    close_us = now_us;
+}
+
+static int halRead(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t)
+{
+    reads++;
+    *t = 0;
+    simRun();
+    if (ackPending && ((int32_t)(now_us - ack_us) >= 0) && (len == 1)) {
+        ackPending = false;
+        pBuffer[0] = ackByte;
+        return 1;
+    }
+    return 0;
+}
+
+static int halWrite(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len)
+{
+    if ((len == 0) || (len > sizeof(txCopy))) {
+        return SH2_ERR_BAD_PARAM;
+    }
+    simRun();
+    if (txBusy) {
+        return 0;
+    }
+
+    // Like the DMA transmit: the data is read out while it goes
+    txBusy = true;
+    pTx = pBuffer;
+    txLen = len;
+    memcpy(txCopy, pBuffer, len);
+    txDone_us = now_us + WIRE_US(len);
+    return len;
+}
+
+static uint32_t halGetTimeUs(sh2_Hal_t *self)
+{
+    return now_us++;
+}
+
+sh2_Hal_t *dfu_hal_init(void)
+{
+    hal.open = halOpen;
+    hal.close = halClose;
+    hal.read = halRead;
+    hal.write = halWrite;
+    hal.getTimeUs = halGetTimeUs;
+
+    return &hal;
+}
+
+// Sleep until the response arrives, or the timeout.
+void dfu_hal_waitRx(sh2_Hal_t *self, uint32_t timeout_us)
+{
+    uint32_t end = now_us + timeout_us;
+
+    simRun();
+    if (txBusy && ((int32_t)(end - txDone_us) > 0)) {
+        now_us = txDone_us;
+        simRun();
+    }
+    if (ackPending && ((int32_t)(end - ack_us) > 0)) {
+        if ((int32_t)(ack_us - now_us) > 0) {
+            now_us = ack_us;
+        }
+    }
+    else {
+        now_us = end;
+    }
+}
+
+// ------------------------------------------------------------------------
+// Simulated firmware image
+
+static int fwOpen(void)
+{
+    nextAppOffset = 0;
+    appDataInOrder = true;
+    return 0;
+}
+
+static int fwClose(void)
+{
+    return 0;
+}
+
+static const char *fwGetMeta(const char *key)
+{
+    if (strcmp(key, "FW-Format") == 0) {
+        return "BNO_V1";
+    }
+    if (strcmp(key, "SW-Part-Number") == 0) {
+        return "1000-3608";
+    }
+    return 0;
+}
+
+static uint32_t fwGetAppLen(void)
+{
+    return APP_LEN;
+}
+
+static uint32_t fwGetPacketLen(void)
+{
+    return PACKET_LEN;
+}
+
+static int fwGetAppData(uint8_t *packet, uint32_t offset, uint32_t len)
+{
+    if ((offset != nextAppOffset) || (offset + len > APP_LEN)) {
+        appDataInOrder = false;
+        return SH2_ERR_BAD_PARAM;
+    }
+    nextAppOffset = offset + len;
+    memcpy(packet, &image[offset], len);
+    now_us += PREP_US;
+    return 0;
+}
+
+const HcBin_t firmware = {
+    fwOpen, fwClose, fwGetMeta, fwGetAppLen, fwGetPacketLen, fwGetAppData,
+};
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testClean(void)
+{
+    uint32_t wire = exchangeUs(6) + exchangeUs(3);
+    uint32_t elapsed;
+
+    for (unsigned n = 0; n < PACKETS; n++) {
+        uint32_t len = (n == PACKETS - 1) ? (APP_LEN - n * PACKET_LEN) : PACKET_LEN;
+        wire += exchangeUs(len + 2);
+    }
+
+    reset(0, false);
+    CHECK(dfu() == SH2_OK);
+    elapsed = close_us - open_us - DELAY_POST_DFU_US;
+
+    CHECK(blOffset == APP_LEN);
+    CHECK(memcmp(blImage, image, APP_LEN) == 0);
+    CHECK(appDataInOrder);
+    CHECK(clobbered == 0);
+    CHECK(totalRetries == 0);
+
+    // Each packet but the first is prepared while the one before is sent
+    CHECK(elapsed >= wire);
+    CHECK(elapsed < wire + 2 * PREP_US + PACKETS * 10);
+
+    // Reads follow responses, they don't poll for them
+    CHECK(reads <= 2 * (PACKETS + 2));
+
+    printf("DFU of %u bytes at %u bps: %.1f ms (%.1f ms on the wire, "
+           "%.1f ms without overlap)\n",
+           APP_LEN, BPS, elapsed / 1000.0, wire / 1000.0,
+           (wire + PACKETS * PREP_US) / 1000.0);
+}
+
+static void testNak(void)
+{
+    // Three packets fail their CRC on the way, and are sent again
+    reset((1u << 3) | (1u << 8) | (1u << 31), false);
+    CHECK(dfu() == SH2_OK);
+
+    CHECK(blOffset == APP_LEN);
+    CHECK(memcmp(blImage, image, APP_LEN) == 0);
+    CHECK(clobbered == 0);
+    CHECK(totalRetries == 3);
+}
+
+static void testNoResponse(void)
+{
+    reset(0, true);
+    CHECK(dfu() == SH2_ERR_TIMEOUT);
+
+    // The app size is sent 5 times, each attempt times out
+    CHECK(close_us - open_us >= 5 * 100000);
+    CHECK(close_us - open_us < 6 * 100000);
+    CHECK(blOffset == 0);
+}
+
+int main(void)
+{
+    for (unsigned n = 0; n < APP_LEN; n++) {
+        image[n] = (uint8_t)(n * 31 + (n >> 8));
+    }
+
+    testClean();
+    testNak();
+    testNoResponse();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Text formatting: fmt_float against the C library's printf, over random
+ * bit patterns and the cases rounding gets wrong, and fmt_timeUs across
+ * the 2^32 us wrap of a 32-bit count.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "test.h"
+
+#define RANDOM_VALUES (200000)
+
+// ------------------------------------------------------------------------
+// Private data
+
+// Width and decimals combinations the demo's output uses, then the rest
+static const struct {
+    unsigned width;
+    unsigned decimals;
+} formats[] = {
+    {0, 6}, {8, 4},
+    {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5},
+    {8, 0}, {8, 1}, {8, 2}, {8, 3}, {8, 5}, {8, 6},
+    {12, 6},
+};
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+static unsigned mismatches;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static uint32_t randomBits(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// Compare fmt_float with printf in every format.  Returns false on the
+// first mismatch.
+static bool checkFloat(float x)
+{
+    char expected[FMT_NUM_MAX + 16];
+    char got[FMT_NUM_MAX + 16];
+
+    for (unsigned f = 0; f < NUM_FORMATS; f++) {
+        unsigned width = formats[f].width;
+        unsigned decimals = formats[f].decimals;
+
+        if (isnan(x)) {
+            // Shown without a sign
+            snprintf(expected, sizeof(expected), "%*s", (int)width, "nan");
+        }
+        else if (!isinf(x) && (fabsf(x) >= 0x1p63f)) {
+            snprintf(expected, sizeof(expected), "%*s", (int)width, "ovf");
+        }
+        else {
+            snprintf(expected, sizeof(expected), "%*.*f", (int)width, (int)decimals, (double)x);
+        }
+        *fmt_float(got, x, width, decimals) = 0;
+
+        if (strcmp(got, expected) != 0) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "fmt_float(%a, %u, %u): \"%s\", printf \"%s\"\n",
+                        (double)x, width, decimals, got, expected);
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static float fromBits(uint32_t bits)
+{
+    float x;
+
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// Expected fmt_timeUs text: seconds, rounded half up at the decimals shown
+static void timeText(char *text, size_t len, uint64_t t_us, unsigned width, unsigned decimals)
+{
+    static const uint32_t unit[7] = { 1000000, 100000, 10000, 1000, 100, 10, 1 };
+    char digits[32];
+    uint64_t units = (t_us + unit[decimals] / 2) / unit[decimals];
+    uint64_t scale = 1000000 / unit[decimals];
+
+    if (decimals == 0) {
+        snprintf(digits, sizeof(digits), "%llu", (unsigned long long)units);
+    }
+    else {
+        snprintf(digits, sizeof(digits), "%llu.%0*llu", (unsigned long long)(units / scale),
+                 (int)decimals, (unsigned long long)(units % scale));
+    }
+    snprintf(text, len, "%*s", (int)width, digits);
+}
+
+static bool checkTime(uint64_t t_us)
+{
+    char expected[FMT_NUM_MAX + 16];
+    char got[FMT_NUM_MAX + 16];
+
+    for (unsigned f = 0; f < NUM_FORMATS; f++) {
+        unsigned width = formats[f].width;
+        unsigned decimals = formats[f].decimals;
+
+        timeText(expected, sizeof(expected), t_us, width, decimals);
+        *fmt_timeUs(got, t_us, width, decimals) = 0;
+        if (strcmp(got, expected) != 0) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "fmt_timeUs(%llu, %u, %u): \"%s\", expected \"%s\"\n",
+                        (unsigned long long)t_us, width, decimals, got, expected);
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testRandom(void)
+{
+    bool ok = true;
+
+    srand(35);
+    for (unsigned n = 0; n < RANDOM_VALUES; n++) {
+        ok = checkFloat(fromBits(randomBits())) && ok;
+    }
+    CHECK(ok);
+
+    // Sensor-like magnitudes, where most of the digits are shown
+    for (unsigned n = 0; n < RANDOM_VALUES; n++) {
+        float x = ((float)randomBits() / 4294967296.0f - 0.5f) * 2000.0f;
+        ok = checkFloat(x) && ok;
+    }
+    CHECK(ok);
+}
+
+static void testSpecial(void)
+{
+    bool ok = true;
+
+    ok = checkFloat(0.0f) && ok;
+    ok = checkFloat(-0.0f) && ok;
+    ok = checkFloat(INFINITY) && ok;
+    ok = checkFloat(-INFINITY) && ok;
+    ok = checkFloat(NAN) && ok;
+    ok = checkFloat(-NAN) && ok;
+
+    // Denormals, and the smallest normals
+    for (uint32_t bits = 1; bits < 0x1000; bits++) {
+        ok = checkFloat(fromBits(bits)) && ok;
+        ok = checkFloat(fromBits(bits | 0x80000000u)) && ok;
+        ok = checkFloat(fromBits(0x007FF000u + bits)) && ok;
+    }
+
+    // Either side of the "ovf" cutoff
+    for (int n = -4; n <= 4; n++) {
+        ok = checkFloat(fromBits(0x5F000000u + n)) && ok;
+        ok = checkFloat(fromBits(0xDF000000u + n)) && ok;
+    }
+    CHECK(ok);
+}
+
+static void testTies(void)
+{
+    bool ok = true;
+
+    // x.5 at 0 decimals: half to even
+    for (int n = -20; n <= 20; n++) {
+        ok = checkFloat((float)n + 0.5f) && ok;
+    }
+
+    // Odd multiples of 2^-m are exact ties at some decimals
+    for (unsigned m = 1; m <= 24; m++) {
+        for (uint32_t k = 1; k < 4096; k += 2) {
+            ok = checkFloat(ldexpf((float)k, -(int)m)) && ok;
+        }
+    }
+
+    // Next to the 6 decimal halfway points
+    static const float halves[] = { 0.0000005f, 0.0000015f, 0.0000025f, 0.5000005f, 1.2345675f };
+    for (unsigned h = 0; h < sizeof(halves) / sizeof(halves[0]); h++) {
+        float x = halves[h];
+        for (int n = 0; n < 4; n++) {
+            x = nextafterf(x, 0.0f);
+        }
+        for (int n = 0; n < 8; n++) {
+            ok = checkFloat(x) && ok;
+            ok = checkFloat(-x) && ok;
+            x = nextafterf(x, 1.0f);
+        }
+    }
+    CHECK(ok);
+}
+
+static void testTime(void)
+{
+    bool ok = true;
+
+    // Across 2^32 us
+    for (uint64_t t = 0xFFFFFFFFull - 2000; t < 0x100000000ull + 2000; t++) {
+        ok = checkTime(t) && ok;
+    }
+
+    ok = checkTime(0) && ok;
+    ok = checkTime(999999) && ok;
+    ok = checkTime(0xFFFFFFFFFFFFull) && ok;
+
+    srand(35);
+    for (unsigned n = 0; n < RANDOM_VALUES / 10; n++) {
+        ok = checkTime(((uint64_t)randomBits() << 16) ^ randomBits()) && ok;
+    }
+    CHECK(ok);
+}
+
+int main(void)
+{
+    testRandom();
+    testSpecial();
+    testTies();
+    testTime();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation math: the CMSIS-DSP kernels (orient.c, on the host's plain C
+ * stand-in for the library) against the one quaternion references
+ * (orient_ref.c), plus the reference's own identities.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "orient.h"
+#include "test.h"
+
+// Not a multiple of the kernels' block length, so a partial block is run
+#define NUM_QUATS (100)
+
+#define TOLERANCE (1.0e-5f)
+
+#define PI (3.14159265f)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static float qw[NUM_QUATS], qx[NUM_QUATS], qy[NUM_QUATS], qz[NUM_QUATS];
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static float randUniform(void)
+{
+    return 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+}
+
+static void randomQuats(void)
+{
+    srand(47);
+    for (unsigned i = 0; i < NUM_QUATS; i++) {
+        float w, x, y, z, norm;
+        do {
+            w = randUniform();
+            x = randUniform();
+            y = randUniform();
+            z = randUniform();
+            norm = sqrtf(w*w + x*x + y*y + z*z);
+        } while ((norm < 0.1f) || (norm > 1.0f));
+        qw[i] = w / norm;
+        qx[i] = x / norm;
+        qy[i] = y / norm;
+        qz[i] = z / norm;
+    }
+}
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) <= TOLERANCE;
+}
+
+// Angles equal, allowing for the wrap at +/- pi
+static bool nearAngle(float a, float b)
+{
+    float d = fabsf(a - b);
+    return (d <= TOLERANCE) || (fabsf(d - 2.0f * PI) <= TOLERANCE);
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testMatrix(void)
+{
+    static float m[9][NUM_QUATS];
+    const float *pQ[4] = { qw, qx, qy, qz };
+    float *pM[9];
+    bool ok = true;
+
+    for (unsigned k = 0; k < 9; k++) {
+        pM[k] = m[k];
+    }
+    orient_quatToMatrix(pQ, pM, NUM_QUATS);
+
+    for (unsigned i = 0; i < NUM_QUATS; i++) {
+        float q[4] = { qw[i], qx[i], qy[i], qz[i] };
+        float ref[9];
+        orient_refQuatToMatrix(q, ref);
+        for (unsigned k = 0; k < 9; k++) {
+            ok = ok && near(m[k][i], ref[k]);
+        }
+    }
+    CHECK(ok);
+}
+
+static void testEuler(void)
+{
+    static float yaw[NUM_QUATS], pitch[NUM_QUATS], roll[NUM_QUATS];
+    const float *pQ[4] = { qw, qx, qy, qz };
+    bool ok = true;
+
+    orient_quatToEuler(pQ, yaw, pitch, roll, NUM_QUATS);
+
+    for (unsigned i = 0; i < NUM_QUATS; i++) {
+        float q[4] = { qw[i], qx[i], qy[i], qz[i] };
+        float refYaw, refPitch, refRoll;
+        orient_refQuatToEuler(q, &refYaw, &refPitch, &refRoll);
+        ok = ok && nearAngle(yaw[i], refYaw);
+        ok = ok && near(pitch[i], refPitch);
+        ok = ok && nearAngle(roll[i], refRoll);
+    }
+    CHECK(ok);
+}
+
+static void testReference(void)
+{
+    const float identity[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    // 90 degrees about z
+    const float yaw90[4] = { sqrtf(0.5f), 0.0f, 0.0f, sqrtf(0.5f) };
+    const float w[3] = { 0.0f, 0.0f, PI / 2.0f };
+    float m[9], q[4];
+    float yaw, pitch, roll;
+
+    orient_refQuatToMatrix(yaw90, m);
+    CHECK(near(m[0], 0.0f) && near(m[1], -1.0f) && near(m[3], 1.0f) && near(m[8], 1.0f));
+
+    orient_refQuatToEuler(yaw90, &yaw, &pitch, &roll);
+    CHECK(near(yaw, PI / 2.0f) && near(pitch, 0.0f) && near(roll, 0.0f));
+
+    // Half way there
+    orient_slerp(identity, yaw90, 0.5f, q);
+    CHECK(near(orient_angle(identity, q), PI / 4.0f));
+    CHECK(near(orient_angle(q, yaw90), PI / 4.0f));
+
+    // One second at 90 deg/s about z
+    // (Compared by component: acos is too coarse near zero angle.)
+    orient_integrate(identity, w, 1.0f, q);
+    CHECK(near(q[0], yaw90[0]) && near(q[1], 0.0f) && near(q[2], 0.0f) && near(q[3], yaw90[3]));
+}
+
+int main(void)
+{
+    randomQuats();
+
+    testMatrix();
+    testEuler();
+    testReference();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Orientation prediction, on a synthetic constant rate rotation, where
+ * extrapolating the angular velocity is exact.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "orient.h"
+#include "predict.h"
+#include "samples.h"
+#include "test.h"
+
+// 100 Hz for less than the history kept
+#define PERIOD_US (10000u)
+#define NUM_SAMPLES (50u)
+
+#define HORIZON_US (20000u)
+
+// Rotation rate about z, rad/s
+#define RATE (1.0f)
+
+#define TOLERANCE (1.0e-3f)
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// The predictor reads the target's cycle counter
+uint32_t dbg_cycles(void)
+{
+    return 0;
+}
+
+// Orientation at t: rotated about z at RATE from identity
+static void orientationAt(uint64_t t_us, float q[4])
+{
+    float half = 0.5f * RATE * (float)t_us * 1.0e-6f;
+
+    q[0] = cosf(half);
+    q[1] = 0.0f;
+    q[2] = 0.0f;
+    q[3] = sinf(half);
+}
+
+static void addGirv(uint64_t t_us)
+{
+    sh2_SensorValue_t value;
+    float q[4];
+
+    orientationAt(t_us, q);
+    memset(&value, 0, sizeof(value));
+    value.sensorId = SH2_GYRO_INTEGRATED_RV;
+    value.timestamp = t_us;
+    value.un.gyroIntegratedRV.real = q[0];
+    value.un.gyroIntegratedRV.i = q[1];
+    value.un.gyroIntegratedRV.j = q[2];
+    value.un.gyroIntegratedRV.k = q[3];
+    value.un.gyroIntegratedRV.angVelZ = RATE;
+    samples_add(&value);
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testStart(void)
+{
+    // Angular velocity only from GIRV or calibrated gyro
+    CHECK(!predict_start(SH2_GAME_ROTATION_VECTOR, SH2_ACCELEROMETER, HORIZON_US));
+    CHECK(!predict_isActive(SH2_GAME_ROTATION_VECTOR));
+    CHECK(!samples_isTracked(SH2_GAME_ROTATION_VECTOR));
+}
+
+static void testPredict(void)
+{
+    PredictStats_t stats;
+    uint64_t t;
+    float q[4], expected[4];
+
+    CHECK(predict_start(SH2_GYRO_INTEGRATED_RV, SH2_GYRO_INTEGRATED_RV, HORIZON_US));
+    CHECK(predict_isActive(SH2_GYRO_INTEGRATED_RV));
+    CHECK(!predict_latest(&t, q));
+
+    for (unsigned n = 1; n <= NUM_SAMPLES; n++) {
+        addGirv((uint64_t)n * PERIOD_US);
+    }
+
+    // Latest sample, carried forward by the horizon
+    CHECK(predict_latest(&t, q));
+    CHECK(t == (uint64_t)NUM_SAMPLES * PERIOD_US + HORIZON_US);
+    orientationAt(t, expected);
+    CHECK(orient_angle(q, expected) < TOLERANCE);
+
+    // Replay: exact but for rounding, where holding lags by the horizon.
+    // Samples a horizon or less before the newest have no later sample to
+    // compare with.
+    CHECK(predict_evaluate(&stats));
+    CHECK(stats.count == NUM_SAMPLES - HORIZON_US / PERIOD_US - 1);
+    CHECK(stats.maxError < TOLERANCE);
+    CHECK(fabsf(stats.meanHoldError - RATE * (float)HORIZON_US * 1.0e-6f) < TOLERANCE);
+
+    predict_stop();
+    CHECK(!predict_isActive(SH2_GYRO_INTEGRATED_RV));
+    CHECK(!samples_isTracked(SH2_GYRO_INTEGRATED_RV));
+}
+
+int main(void)
+{
+    testStart();
+    testPredict();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-sensor time alignment: staggered acc, gyro and rotation vector
+ * streams, linear in time (and a constant rate rotation), so the
+ * interpolated values are known at every grid point.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "orient.h"
+#include "resample.h"
+#include "samples.h"
+#include "test.h"
+
+// Output grid
+#define PERIOD_US (10000u)
+
+// Input intervals and phases
+#define ACC_US (2500u)
+#define ACC_PHASE_US (300u)
+#define GYRO_US (5000u)
+#define GYRO_PHASE_US (1100u)
+#define RV_US (10000u)
+#define RV_PHASE_US (4700u)
+
+// Rotation rate about z, rad/s
+#define RATE (10.0f)
+
+#define TOLERANCE (1.0e-4f)
+
+#define MAX_RECORDS (1000)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static ResampleRecord_t records[MAX_RECORDS];
+static unsigned numRecords;
+
+// Next sample time of each input, and whether it is producing
+static uint64_t nextAcc_us, nextGyro_us, nextRv_us;
+static bool gyroRunning;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static float seconds(uint64_t t_us)
+{
+    return (float)t_us * 1.0e-6f;
+}
+
+static void expectedAcc(uint64_t t_us, float v[3])
+{
+    v[0] = seconds(t_us);
+    v[1] = 2.0f * seconds(t_us);
+    v[2] = -seconds(t_us);
+}
+
+static void expectedGyro(uint64_t t_us, float v[3])
+{
+    v[0] = 1.0f + seconds(t_us);
+    v[1] = 0.5f * seconds(t_us);
+    v[2] = 3.0f;
+}
+
+static void expectedOrientation(uint64_t t_us, float q[4])
+{
+    float half = 0.5f * RATE * seconds(t_us);
+
+    q[0] = cosf(half);
+    q[1] = 0.0f;
+    q[2] = 0.0f;
+    q[3] = sinf(half);
+}
+
+static void onRecord(void *cookie, const ResampleRecord_t *pRecord)
+{
+    (void)cookie;
+    if (numRecords < MAX_RECORDS) {
+        records[numRecords++] = *pRecord;
+    }
+}
+
+static void add(sh2_SensorId_t sensorId, uint64_t t_us)
+{
+    sh2_SensorValue_t value;
+    float v[4];
+
+    memset(&value, 0, sizeof(value));
+    value.sensorId = sensorId;
+    value.timestamp = t_us;
+    switch (sensorId) {
+        case SH2_ACCELEROMETER:
+            expectedAcc(t_us, v);
+            value.un.accelerometer.x = v[0];
+            value.un.accelerometer.y = v[1];
+            value.un.accelerometer.z = v[2];
+            break;
+        case SH2_GYROSCOPE_CALIBRATED:
+            expectedGyro(t_us, v);
+            value.un.gyroscope.x = v[0];
+            value.un.gyroscope.y = v[1];
+            value.un.gyroscope.z = v[2];
+            break;
+        default:
+            expectedOrientation(t_us, v);
+            value.un.gameRotationVector.real = v[0];
+            value.un.gameRotationVector.i = v[1];
+            value.un.gameRotationVector.j = v[2];
+            value.un.gameRotationVector.k = v[3];
+            break;
+    }
+    samples_add(&value);
+}
+
+// Add input samples in time order up to until_us, servicing the
+// resampler after each, as the main loop does.
+static void run(uint64_t until_us)
+{
+    for (;;) {
+        uint64_t t = nextAcc_us;
+        if (gyroRunning && (nextGyro_us < t)) {
+            t = nextGyro_us;
+        }
+        if (nextRv_us < t) {
+            t = nextRv_us;
+        }
+        if (t > until_us) {
+            return;
+        }
+
+        if (t == nextAcc_us) {
+            add(SH2_ACCELEROMETER, t);
+            nextAcc_us += ACC_US;
+        }
+        else if (gyroRunning && (t == nextGyro_us)) {
+            add(SH2_GYROSCOPE_CALIBRATED, t);
+            nextGyro_us += GYRO_US;
+        }
+        else {
+            add(SH2_GAME_ROTATION_VECTOR, t);
+            nextRv_us += RV_US;
+        }
+        resample_service();
+    }
+}
+
+// Check records from first on: on the grid, in order, values as expected.
+// Returns the number of grid points missing between them.
+static unsigned checkRecords(unsigned first)
+{
+    unsigned missing = 0;
+    bool ok = true;
+
+    for (unsigned n = first; n < numRecords; n++) {
+        const ResampleRecord_t *pR = &records[n];
+        float acc[3], gyro[3], q[4];
+
+        ok = ok && ((pR->timestamp_us % PERIOD_US) == 0);
+        if (n > first) {
+            uint64_t step = pR->timestamp_us - records[n-1].timestamp_us;
+            ok = ok && (step >= PERIOD_US);
+            missing += (unsigned)(step / PERIOD_US) - 1;
+        }
+
+        expectedAcc(pR->timestamp_us, acc);
+        expectedGyro(pR->timestamp_us, gyro);
+        expectedOrientation(pR->timestamp_us, q);
+        for (unsigned c = 0; c < 3; c++) {
+            ok = ok && (fabsf(pR->acc[c] - acc[c]) < TOLERANCE);
+            ok = ok && (fabsf(pR->gyro[c] - gyro[c]) < TOLERANCE);
+        }
+        for (unsigned c = 0; c < 4; c++) {
+            ok = ok && (fabsf(pR->orientation[c] - q[c]) < TOLERANCE);
+        }
+    }
+    CHECK(ok);
+
+    return missing;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testAligned(void)
+{
+    nextAcc_us = ACC_PHASE_US;
+    nextGyro_us = GYRO_PHASE_US;
+    nextRv_us = RV_PHASE_US;
+    gyroRunning = true;
+    numRecords = 0;
+
+    CHECK(resample_start(SH2_ACCELEROMETER, SH2_GYROSCOPE_CALIBRATED,
+                         SH2_GAME_ROTATION_VECTOR, PERIOD_US, onRecord, 0));
+    run(500000);
+
+    // First grid point after every input's first sample (the RV's)
+    CHECK(numRecords > 0);
+    CHECK(records[0].timestamp_us == 10000);
+
+    // Every grid point since, up to where the RV has passed
+    CHECK(checkRecords(0) == 0);
+    CHECK(records[numRecords-1].timestamp_us == 490000);
+    CHECK(resample_skipped() == 0);
+}
+
+static void testStall(void)
+{
+    unsigned first = numRecords;
+
+    // Gyro stops for longer than the acc history (64 samples, 160 ms):
+    // the grid points it held up fall out of the acc history.
+    gyroRunning = false;
+    run(800000);
+    CHECK(numRecords == first);
+
+    nextGyro_us = 800000 + GYRO_PHASE_US;
+    gyroRunning = true;
+    run(1200000);
+    CHECK(numRecords > first);
+
+    // Skipped points are exactly the ones missing from the output
+    CHECK(resample_skipped() > 0);
+    CHECK(checkRecords(first - 1) == resample_skipped());
+}
+
+static void testRestart(void)
+{
+    uint32_t skipped = resample_skipped();
+    uint64_t restart_us;
+    unsigned first;
+
+    // Acc history emptied, as when it stops being tracked
+    samples_untrack(SH2_ACCELEROMETER);
+    CHECK(samples_track(SH2_ACCELEROMETER));
+    first = numRecords;
+    resample_service();
+    resample_service();
+    CHECK(numRecords == first);
+    CHECK(resample_skipped() == skipped);
+
+    // Acc comes back later: output restarts on the grid after its first
+    // new sample
+    nextAcc_us = 1300000 + ACC_PHASE_US;
+    run(1600000);
+    restart_us = ((1300000 + ACC_PHASE_US + PERIOD_US - 1) / PERIOD_US) * PERIOD_US;
+    CHECK(numRecords > first);
+    CHECK(records[first].timestamp_us == restart_us);
+    CHECK(checkRecords(first) == 0);
+    CHECK(resample_skipped() == skipped);
+
+    resample_stop();
+    CHECK(!samples_isTracked(SH2_ACCELEROMETER));
+    CHECK(!samples_isTracked(SH2_GYROSCOPE_CALIBRATED));
+    CHECK(!samples_isTracked(SH2_GAME_ROTATION_VECTOR));
+}
+
+int main(void)
+{
+    testAligned();
+    testStall();
+    testRestart();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * UART-SHTP frame encoder: checked against the txEncode()/txStore() encoder
+ * the UART HAL used to have, and timed against it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rfc1662.h"
+#include "sh2_hal.h"
+#include "test.h"
+
+#define PROTOCOL_SHTP (1)
+
+#define FRAME_MAX RFC1662_FRAME_MAX(SH2_HAL_MAX_TRANSFER_OUT)
+
+// Payloads compared with the reference encoder
+#define RANDOM_PAYLOADS (10000)
+
+// Frames encoded by each encoder in the timing comparison
+#define TIMED_FRAMES (1000000u)
+
+// ------------------------------------------------------------------------
+// Private functions
+
+// The encoder the UART HAL used to have, as it was: each byte goes through
+// txStore(), which checks it against the staging array.
+static uint8_t txFrame[2*SH2_HAL_MAX_TRANSFER_OUT+2];
+static uint32_t txFrameLen;
+
+static void txStore(uint8_t c)
+{
+    if (txFrameLen < sizeof(txFrame)) {
+        txFrame[txFrameLen] = c;
+    }
+    txFrameLen++;
+}
+
+static void txEncode(uint8_t *pSrc, uint32_t len)
+{
+    uint32_t i = 0;
+
+    txFrameLen = 0;
+
+    // Start of frame
+    txStore(RFC1662_FLAG);
+
+    // Protocol ID
+    txStore(PROTOCOL_SHTP);
+
+    // Frame contents
+    for (i = 0; i < len; i++) {
+        if ((pSrc[i] == RFC1662_FLAG) ||
+            (pSrc[i] == RFC1662_ESCAPE)) {
+            // Store escaped character
+            txStore(RFC1662_ESCAPE);
+            txStore(pSrc[i] ^ 0x20);
+        }
+        else {
+            // store the character normally
+            txStore(pSrc[i]);
+        }
+    }
+
+    // End of frame
+    txStore(RFC1662_FLAG);
+}
+
+// The old encoder behind the rfc1662_encode() signature.  Its staging array
+// was one byte short of an all-escaped full size frame; the length returned
+// counts every byte, stored or not.
+static uint32_t encodeOld(uint8_t *pDst, uint8_t protocol, const uint8_t *pSrc, uint32_t len)
+{
+    (void)pDst;
+    (void)protocol;
+    txEncode((uint8_t *)pSrc, len);
+    return txFrameLen;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testKnown(void)
+{
+    const uint8_t payload[] = { 0x01, RFC1662_FLAG, 0x02, RFC1662_ESCAPE, RFC1662_ESCAPE };
+    const uint8_t expected[] = {
+        RFC1662_FLAG, PROTOCOL_SHTP,
+        0x01, RFC1662_ESCAPE, 0x5e, 0x02, RFC1662_ESCAPE, 0x5d, RFC1662_ESCAPE, 0x5d,
+        RFC1662_FLAG,
+    };
+    uint8_t frame[FRAME_MAX];
+
+    CHECK(rfc1662_encode(frame, PROTOCOL_SHTP, payload, sizeof(payload)) == sizeof(expected));
+    CHECK(memcmp(frame, expected, sizeof(expected)) == 0);
+
+    // Empty payload
+    CHECK(rfc1662_encode(frame, PROTOCOL_SHTP, payload, 0) == 3);
+    CHECK((frame[0] == RFC1662_FLAG) && (frame[1] == PROTOCOL_SHTP) && (frame[2] == RFC1662_FLAG));
+}
+
+static void testMatchesOld(void)
+{
+    uint8_t payload[SH2_HAL_MAX_TRANSFER_OUT];
+    uint8_t frame[FRAME_MAX + 1];
+    unsigned mismatches = 0;
+
+    srand(1);
+    for (unsigned n = 0; n < RANDOM_PAYLOADS; n++) {
+        uint32_t len = rand() % (sizeof(payload) + 1);
+
+        // Mostly plain bytes, with flags and escapes at varying density,
+        // including all of them.
+        unsigned density = n % 5;
+        for (uint32_t i = 0; i < len; i++) {
+            unsigned r = rand() % 4;
+            if ((density == 4) || (r < density)) {
+                payload[i] = (rand() & 1) ? RFC1662_FLAG : RFC1662_ESCAPE;
+            }
+            else {
+                payload[i] = (uint8_t)rand();
+            }
+        }
+
+        // A guard byte past the frame shows any overrun
+        memset(frame, 0xA5, sizeof(frame));
+        uint32_t frameLen = rfc1662_encode(frame, PROTOCOL_SHTP, payload, len);
+        uint32_t refLen = encodeOld(0, PROTOCOL_SHTP, payload, len);
+        uint32_t stored = (refLen < sizeof(txFrame)) ? refLen : sizeof(txFrame);
+        if ((frameLen != refLen) || (memcmp(frame, txFrame, stored) != 0) ||
+            (frame[frameLen] != 0xA5)) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Time both encoders on a typical set feature command, a full size payload
+// with nothing to escape and one with every byte escaped.  They are called
+// through pointers so neither is inlined into the loop, and a byte of each
+// output is read back so its stores are not optimized away.
+static void testThroughput(void)
+{
+    static const uint8_t typical[21] = {
+        0x15, 0x00, 0x02, 0x00, 0xFD, 0x08, 0x00, 0x00, 0x00, 0x00, 0x10,
+        0x27, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    static uint8_t plain[SH2_HAL_MAX_TRANSFER_OUT];
+    static uint8_t worst[SH2_HAL_MAX_TRANSFER_OUT];
+    static uint8_t frame[FRAME_MAX];
+    uint32_t (* volatile encodeNew)(uint8_t *, uint8_t, const uint8_t *, uint32_t) = rfc1662_encode;
+    uint32_t (* volatile encodePrev)(uint8_t *, uint8_t, const uint8_t *, uint32_t) = encodeOld;
+    struct {
+        const char *name;
+        const uint8_t *pSrc;
+        uint32_t len;
+    } cases[] = {
+        {"typical", typical, sizeof(typical)},
+        {"plain", plain, sizeof(plain)},
+        {"escaped", worst, sizeof(worst)},
+    };
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < sizeof(plain); i++) {
+        plain[i] = (uint8_t)(i * 3 + 1);
+    }
+    memset(worst, RFC1662_FLAG, sizeof(worst));
+
+    for (unsigned c = 0; c < sizeof(cases)/sizeof(cases[0]); c++) {
+        double start, newTime, oldTime;
+
+        start = now();
+        for (uint32_t n = 0; n < TIMED_FRAMES; n++) {
+            sum += encodeNew(frame, PROTOCOL_SHTP, cases[c].pSrc, cases[c].len);
+            sum += frame[n % cases[c].len];
+        }
+        newTime = now() - start;
+
+        start = now();
+        for (uint32_t n = 0; n < TIMED_FRAMES; n++) {
+            sum += encodePrev(frame, PROTOCOL_SHTP, cases[c].pSrc, cases[c].len);
+            sum += txFrame[n % cases[c].len];
+        }
+        oldTime = now() - start;
+
+        // (sum keeps the encoding from being optimized away)
+        printf("Encode ns/frame, %s %u bytes: rfc1662_encode %.1f, old txEncode %.1f (%u)\n",
+               cases[c].name, (unsigned)cases[c].len,
+               newTime / TIMED_FRAMES * 1e9, oldTime / TIMED_FRAMES * 1e9,
+               (unsigned)(sum & 1));
+    }
+}
+
+int main(void)
+{
+    testKnown();
+    testMatchesOld();
+    testThroughput();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Ring buffer: unit checks, a two thread stress test and a throughput
+ * comparison against the byte-wise FIFO the console used to have.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "ring.h"
+#include "test.h"
+
+#define RING_LEN (64)
+
+// Bytes passed through the ring in the stress test
+#define STRESS_BYTES (4000000u)
+
+// Bytes passed through each FIFO in the throughput comparison
+#define THROUGHPUT_BYTES (50000000u)
+#define CHUNK_LEN (48)
+
+// ------------------------------------------------------------------------
+// Private data
+
+static Ring_t ring;
+static uint8_t ringBuf[RING_LEN];
+
+// The console's FIFO before the ring: one byte at a time, modulo wrap.
+typedef struct {
+    uint8_t *buffer;
+    unsigned len;
+    unsigned in;
+    unsigned out;
+} ByteFifo_t;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static unsigned fifoInsert(ByteFifo_t *f, const uint8_t *pData, unsigned len)
+{
+    unsigned n;
+
+    for (n = 0; n < len; n++) {
+        unsigned next = (f->in + 1) % f->len;
+        if (next == f->out) {
+            break;
+        }
+        f->buffer[f->in] = pData[n];
+        f->in = next;
+    }
+    return n;
+}
+
+static unsigned fifoRemove(ByteFifo_t *f, uint8_t *pData, unsigned len)
+{
+    unsigned n;
+
+    for (n = 0; (n < len) && (f->out != f->in); n++) {
+        pData[n] = f->buffer[f->out];
+        f->out = (f->out + 1) % f->len;
+    }
+    return n;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *stressProducer(void *arg)
+{
+    uint8_t chunk[RING_LEN];
+    uint32_t next = 0;
+    unsigned len = 1;
+
+    (void)arg;
+    while (next < STRESS_BYTES) {
+        // Vary the size, so inserts land across the wrap point
+        len = (len % (RING_LEN + 3)) + 1;
+        if (len > STRESS_BYTES - next) {
+            len = STRESS_BYTES - next;
+        }
+        if (len > RING_LEN) {
+            len = RING_LEN;
+        }
+        for (unsigned n = 0; n < len; n++) {
+            chunk[n] = (uint8_t)((next + n) * 7);
+        }
+        len = ring_insert(&ring, chunk, len);
+        if (len == 0) {
+            // Full: let the consumer run (the host may have one core)
+            sched_yield();
+        }
+        next += len;
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testEmptyFull(void)
+{
+    uint8_t data[RING_LEN + 8];
+    uint8_t out[RING_LEN + 8];
+
+    for (unsigned n = 0; n < sizeof(data); n++) {
+        data[n] = (uint8_t)n;
+    }
+    ring_init(&ring, ringBuf, RING_LEN);
+
+    CHECK(ring_used(&ring) == 0);
+    CHECK(ring_free(&ring) == RING_LEN);
+    CHECK(ring_remove(&ring, out, 1) == 0);
+
+    // Inserting past full stores what fits
+    CHECK(ring_insert(&ring, data, sizeof(data)) == RING_LEN);
+    CHECK(ring_used(&ring) == RING_LEN);
+    CHECK(ring_free(&ring) == 0);
+    CHECK(ring_insert1(&ring, 0xAA) == 0);
+
+    CHECK(ring_remove(&ring, out, sizeof(out)) == RING_LEN);
+    CHECK(memcmp(out, data, RING_LEN) == 0);
+    CHECK(ring_used(&ring) == 0);
+}
+
+static void testWrap(void)
+{
+    uint8_t data[RING_LEN];
+    uint8_t out[RING_LEN];
+
+    for (unsigned n = 0; n < sizeof(data); n++) {
+        data[n] = (uint8_t)(n + 100);
+    }
+
+    // Start near the end of the buffer, and near the 2^32 wrap of the
+    // counters.
+    ring_init(&ring, ringBuf, RING_LEN);
+    ring.head = ring.tail = 0xFFFFFFF0u + RING_LEN - 5;
+
+    CHECK(ring_insert(&ring, data, 20) == 20);
+    CHECK(ring_used(&ring) == 20);
+    CHECK(ring_at(&ring, 0) == data[0]);
+    CHECK(ring_at(&ring, 19) == data[19]);
+    CHECK(ring_remove(&ring, out, 20) == 20);
+    CHECK(memcmp(out, data, 20) == 0);
+
+    // Byte at a time across the wrap
+    for (unsigned n = 0; n < RING_LEN; n++) {
+        CHECK(ring_insert1(&ring, data[n]) == 1);
+    }
+    CHECK(ring_insert1(&ring, 0) == 0);
+    CHECK(ring_remove(&ring, out, RING_LEN) == RING_LEN);
+    CHECK(memcmp(out, data, RING_LEN) == 0);
+}
+
+static void testPeekConsume(void)
+{
+    uint8_t data[40];
+    uint8_t *p;
+    unsigned len;
+
+    for (unsigned n = 0; n < sizeof(data); n++) {
+        data[n] = (uint8_t)(n + 1);
+    }
+
+    // 40 bytes starting 10 before the end of the buffer
+    ring_init(&ring, ringBuf, RING_LEN);
+    ring.head = ring.tail = RING_LEN - 10;
+    CHECK(ring_insert(&ring, data, sizeof(data)) == sizeof(data));
+
+    // First span runs to the end of the buffer
+    len = ring_peek(&ring, 0, &p);
+    CHECK(len == 10);
+    CHECK(memcmp(p, data, 10) == 0);
+
+    // Past it, the rest from the start of the buffer
+    len = ring_peek(&ring, 10, &p);
+    CHECK(len == 30);
+    CHECK(p == ringBuf);
+    CHECK(memcmp(p, data + 10, 30) == 0);
+
+    // Nothing past the head
+    CHECK(ring_peek(&ring, 40, &p) == 0);
+    CHECK(ring_peek(&ring, 50, &p) == 0);
+
+    // Peek does not remove
+    CHECK(ring_used(&ring) == 40);
+    ring_consume(&ring, 10);
+    CHECK(ring_used(&ring) == 30);
+    len = ring_peek(&ring, 0, &p);
+    CHECK(len == 30);
+    CHECK(p[0] == data[10]);
+
+    // Take back the last bytes inserted
+    ring_unwrite(&ring, 5);
+    CHECK(ring_used(&ring) == 25);
+    CHECK(ring_at(&ring, 24) == data[34]);
+    CHECK(ring_insert1(&ring, 0xEE) == 1);
+    CHECK(ring_at(&ring, 25) == 0xEE);
+}
+
+static void testStress(void)
+{
+    pthread_t producer;
+    uint8_t chunk[RING_LEN];
+    uint32_t next = 0;
+    unsigned len = 1;
+    bool ok = true;
+
+    ring_init(&ring, ringBuf, RING_LEN);
+    pthread_create(&producer, 0, stressProducer, 0);
+
+    // Consume with a mix of remove and peek/consume, checking every byte
+    while (next < STRESS_BYTES) {
+        len = (len % (RING_LEN + 5)) + 1;
+        if (len & 1) {
+            unsigned got = ring_remove(&ring, chunk, len);
+            for (unsigned n = 0; n < got; n++) {
+                ok = ok && (chunk[n] == (uint8_t)((next + n) * 7));
+            }
+            next += got;
+        }
+        else {
+            uint8_t *p;
+            unsigned got = ring_peek(&ring, 0, &p);
+            if (got > len) {
+                got = len;
+            }
+            for (unsigned n = 0; n < got; n++) {
+                ok = ok && (p[n] == (uint8_t)((next + n) * 7));
+            }
+            ring_consume(&ring, got);
+            next += got;
+        }
+        if (ring_used(&ring) == 0) {
+            // Empty: let the producer run
+            sched_yield();
+        }
+    }
+    pthread_join(producer, 0);
+
+    CHECK(ok);
+    CHECK(ring_used(&ring) == 0);
+}
+
+static void testThroughput(void)
+{
+    static uint8_t buf[1024];
+    uint8_t in[CHUNK_LEN], out[CHUNK_LEN];
+    ByteFifo_t fifo = { buf, sizeof(buf), 0, 0 };
+    double start, ringTime, fifoTime;
+    uint32_t sum = 0;
+
+    for (unsigned n = 0; n < CHUNK_LEN; n++) {
+        in[n] = (uint8_t)n;
+    }
+
+    ring_init(&ring, buf, sizeof(buf));
+    start = now();
+    for (uint32_t moved = 0; moved < THROUGHPUT_BYTES; moved += CHUNK_LEN) {
+        ring_insert(&ring, in, CHUNK_LEN);
+        ring_remove(&ring, out, CHUNK_LEN);
+        sum += out[moved % CHUNK_LEN];
+    }
+    ringTime = now() - start;
+
+    start = now();
+    for (uint32_t moved = 0; moved < THROUGHPUT_BYTES; moved += CHUNK_LEN) {
+        fifoInsert(&fifo, in, CHUNK_LEN);
+        fifoRemove(&fifo, out, CHUNK_LEN);
+        sum += out[moved % CHUNK_LEN];
+    }
+    fifoTime = now() - start;
+
+    // (sum keeps the copies from being optimized away)
+    printf("Throughput, %u byte chunks: ring %.0f MB/s, byte-wise FIFO %.0f MB/s (%u)\n",
+           CHUNK_LEN, THROUGHPUT_BYTES / ringTime / 1e6, THROUGHPUT_BYTES / fifoTime / 1e6,
+           (unsigned)(sum & 1));
+}
+
+int main(void)
+{
+    testEmptyFull();
+    testWrap();
+    testPeekConsume();
+    testStress();
+    testThroughput();
+
+    return TEST_RESULT();
+}
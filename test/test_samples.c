@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sample history: time queries, including with late events offered.
+ */
+
+#include <string.h>
+
+#include "samples.h"
+#include "test.h"
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static bool addAcc(uint64_t t_us, float x)
+{
+    sh2_SensorValue_t value;
+
+    memset(&value, 0, sizeof(value));
+    value.sensorId = SH2_ACCELEROMETER;
+    value.timestamp = t_us;
+    value.un.accelerometer.x = x;
+
+    return samples_add(&value);
+}
+
+static uint64_t sliceTime(const SampleSlice_t *pSlice, unsigned n)
+{
+    if (n < pSlice->count[0]) {
+        return pSlice->pTimestamp_us[0][n];
+    }
+    return pSlice->pTimestamp_us[1][n - pSlice->count[0]];
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testWindow(void)
+{
+    SampleSlice_t slice;
+
+    CHECK(samples_track(SH2_ACCELEROMETER));
+
+    // More than SAMPLES_DEPTH samples, 1ms apart, so the ring wraps
+    for (unsigned n = 0; n < SAMPLES_DEPTH + 10; n++) {
+        CHECK(addAcc(1000 * (uint64_t)n, (float)n));
+    }
+
+    CHECK(samples_window(SH2_ACCELEROMETER, 50000, 60000, &slice) == 10);
+    CHECK(sliceTime(&slice, 0) == 50000);
+    CHECK(sliceTime(&slice, 9) == 59000);
+
+    CHECK(samples_around(SH2_ACCELEROMETER, 55500, &slice) == 2);
+    CHECK(sliceTime(&slice, 0) == 55000);
+    CHECK(sliceTime(&slice, 1) == 56000);
+
+    // Older than the samples kept
+    CHECK(samples_around(SH2_ACCELEROMETER, 5000, &slice) == 0);
+
+    samples_untrack(SH2_ACCELEROMETER);
+}
+
+static void testLateSamples(void)
+{
+    SampleSlice_t slice;
+    uint64_t t;
+    float c[SAMPLES_MAX_COMPONENTS];
+    uint64_t prev = 0;
+
+    CHECK(samples_track(SH2_ACCELEROMETER));
+
+    CHECK(addAcc(10000, 1.0f));
+    CHECK(addAcc(20000, 2.0f));
+    CHECK(addAcc(30000, 3.0f));
+
+    // Late events are not stored
+    CHECK(!addAcc(15000, 9.0f));
+    CHECK(!addAcc(29999, 9.0f));
+
+    // Same time as the newest is still in order
+    CHECK(addAcc(30000, 4.0f));
+    CHECK(addAcc(40000, 5.0f));
+
+    CHECK(samples_latest(SH2_ACCELEROMETER, &t, c) == 3);
+    CHECK(t == 40000);
+    CHECK(c[0] == 5.0f);
+
+    // Queries see only in-order samples
+    CHECK(samples_last(SH2_ACCELEROMETER, SAMPLES_DEPTH, &slice) == 5);
+    for (unsigned n = 0; n < 5; n++) {
+        CHECK(sliceTime(&slice, n) >= prev);
+        prev = sliceTime(&slice, n);
+    }
+    CHECK(samples_window(SH2_ACCELEROMETER, 12000, 30001, &slice) == 3);
+    CHECK(samples_around(SH2_ACCELEROMETER, 16000, &slice) == 2);
+    CHECK(sliceTime(&slice, 0) == 10000);
+    CHECK(sliceTime(&slice, 1) == 20000);
+
+    samples_untrack(SH2_ACCELEROMETER);
+}
+
+int main(void)
+{
+    testWindow();
+    testLateSamples();
+
+    return TEST_RESULT();
+}
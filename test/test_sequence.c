@@ -0,0 +1,162 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sequence number accounting: wrap, gaps, duplicates and reordering.
+ */
+
+#include <string.h>
+
+#include "sequence.h"
+#include "test.h"
+
+// ------------------------------------------------------------------------
+// Private data
+
+static SequenceStats_t stats;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static void start(uint8_t sequence)
+{
+    memset(&stats, 0, sizeof(stats));
+    sequence_check(&stats, sequence);
+}
+
+// Check n reports in order from first, wrapping in 8 bits
+static void inOrder(uint8_t first, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        sequence_check(&stats, (uint8_t)(first + i));
+    }
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testWrap(void)
+{
+    start(250);
+    inOrder(251, 20);
+
+    CHECK(stats.received == 21);
+    CHECK(stats.lost == 0);
+    CHECK(stats.duplicate == 0);
+    CHECK(stats.late == 0);
+    CHECK(stats.sequence == 270);
+    CHECK(sequence_extend(&stats, 14) == 270);
+}
+
+static void testGap(void)
+{
+    // 200 reports lost, e.g. 200 ms of stall at 1 kHz
+    start(10);
+    sequence_check(&stats, (uint8_t)(10 + 201));
+    CHECK(stats.lost == 200);
+    CHECK(stats.late == 0);
+    CHECK(stats.sequence == 211);
+
+    // Later reports are in order from there
+    inOrder((uint8_t)(212), 127);
+    CHECK(stats.lost == 200);
+    CHECK(stats.late == 0);
+    CHECK(stats.sequence == 338);
+
+    // The largest gap seen as lost
+    start(0);
+    sequence_check(&stats, 0x100 - SEQUENCE_LATE_WINDOW - 1);
+    CHECK(stats.lost == 0x100 - SEQUENCE_LATE_WINDOW - 2);
+    CHECK(stats.late == 0);
+}
+
+static void testDuplicate(void)
+{
+    start(5);
+    sequence_check(&stats, 5);
+    sequence_check(&stats, 6);
+    sequence_check(&stats, 6);
+
+    CHECK(stats.received == 4);
+    CHECK(stats.duplicate == 2);
+    CHECK(stats.lost == 0);
+    CHECK(stats.sequence == 6);
+}
+
+static void testReorder(void)
+{
+    // 254 and 0 swapped and 1 delayed, across the wrap
+    start(253);
+    sequence_check(&stats, 0);
+    CHECK(stats.lost == 2);
+    sequence_check(&stats, 254);
+    sequence_check(&stats, 255);
+    CHECK(stats.late == 2);
+    CHECK(stats.lost == 0);
+    CHECK(sequence_extend(&stats, 255) == 255);
+    CHECK(stats.sequence == 256);
+
+    sequence_check(&stats, 2);
+    sequence_check(&stats, 1);
+    CHECK(stats.late == 3);
+    CHECK(stats.lost == 0);
+    CHECK(stats.sequence == 258);
+
+    // Late by the whole window
+    sequence_check(&stats, (uint8_t)(258 - SEQUENCE_LATE_WINDOW));
+    CHECK(stats.late == 4);
+    CHECK(stats.sequence == 258);
+}
+
+static void testHubReset(void)
+{
+    // IDs carry on past the last one, whatever the hub restarts from
+    start(250);
+    inOrder(251, 10);
+    CHECK(stats.sequence == 260);
+
+    stats.started = false;
+    sequence_check(&stats, 0);
+    CHECK(stats.sequence == 0x200);
+    CHECK(sequence_extend(&stats, 0) == 0x200);
+    inOrder(1, 5);
+    CHECK(stats.sequence == 0x205);
+    CHECK(stats.lost == 0);
+    CHECK(stats.received == 17);
+
+    // Restarting where the last one left off
+    stats.started = false;
+    sequence_check(&stats, 6);
+    CHECK(stats.sequence == 0x206);
+
+    // Restarting on the same 8 bits still moves on
+    stats.started = false;
+    sequence_check(&stats, 6);
+    CHECK(stats.sequence == 0x306);
+    CHECK(stats.duplicate == 0);
+}
+
+int main(void)
+{
+    testWrap();
+    testGap();
+    testDuplicate();
+    testReorder();
+    testHubReset();
+
+    return TEST_RESULT();
+}
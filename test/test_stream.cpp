@@ -0,0 +1,305 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Binary stream: records from app/stream.c, decoded by tools/stream_decode.
+ */
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "log.h"
+#include "stream.h"
+}
+#include "stream_decode.h"
+#include "test.h"
+
+// ------------------------------------------------------------------------
+// Console stand-in: collects the bytes the stream writes
+
+static std::vector<uint8_t> written;
+static bool consoleFull;
+
+extern "C" bool console_writeRaw(const uint8_t *pData, unsigned len)
+{
+    if (consoleFull) {
+        return false;
+    }
+    written.insert(written.end(), pData, pData + len);
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static sh2_SensorEvent_t grvEvent(uint64_t timestamp_us, uint8_t seq)
+{
+    // Game rotation vector: header, then i, j, k, real in Q14
+    static const uint8_t report[12] = {
+        SH2_GAME_ROTATION_VECTOR, 0, 0x03, 0,
+        0x00, 0x20,   // i = 0.5
+        0x00, 0xE0,   // j = -0.5
+        0x00, 0x00,   // k = 0
+        0x00, 0x40,   // real = 1.0
+    };
+    sh2_SensorEvent_t event;
+
+    memset(&event, 0, sizeof(event));
+    event.timestamp_uS = timestamp_us;
+    event.reportId = SH2_GAME_ROTATION_VECTOR;
+    event.len = sizeof(report);
+    memcpy(event.report, report, sizeof(report));
+    event.report[1] = seq;
+
+    return event;
+}
+
+static void decode(sh2stream::Decoder &decoder)
+{
+    decoder.feed(written.data(), written.size());
+    written.clear();
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testSensorRecords(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    sh2_SensorEvent_t event;
+
+    stream_reset();
+    event = grvEvent(1500000, 7);
+    CHECK(stream_sendEvent(&event));
+    event = grvEvent(1510000, 8);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    CHECK(dsf.str() ==
+          ".8 1.500000, 7, 1.000000, 0.500000, -0.500000, 0.000000\n"
+          ".8 1.510000, 8, 1.000000, 0.500000, -0.500000, 0.000000\n");
+    CHECK(decoder.stats().records == 2);
+    CHECK(decoder.stats().lostRecords == 0);
+    CHECK(decoder.stats().badFrames == 0);
+}
+
+static void testLateEvent(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    sh2_SensorEvent_t event;
+
+    stream_reset();
+    event = grvEvent(2000000, 1);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    // A late event has a small negative delta: it must stay short
+    event = grvEvent(1999000, 0);
+    CHECK(stream_sendEvent(&event));
+    CHECK(written.size() < 2 + 2 + 3 + sizeof(event.report));
+    decode(decoder);
+
+    event = grvEvent(2001000, 2);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    std::string out = dsf.str();
+    CHECK(out.find(".8 1.999000, 0,") != std::string::npos);
+    CHECK(out.find(".8 2.001000, 2,") != std::string::npos);
+}
+
+static void testSequenceGap(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    sh2_SensorEvent_t event;
+
+    // Gaps of 200 and 128 reports are lost reports, as the demo counts
+    // them, not late ones
+    stream_reset();
+    event = grvEvent(1000000, 10);
+    CHECK(stream_sendEvent(&event));
+    event = grvEvent(1200000, 210);
+    CHECK(stream_sendEvent(&event));
+    event = grvEvent(1328000, (uint8_t)(210 + 128));
+    CHECK(stream_sendEvent(&event));
+    // Within the late window: behind the last one
+    event = grvEvent(1327000, (uint8_t)(210 + 127));
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    std::string out = dsf.str();
+    CHECK(out.find(".8 1.200000, 210,") != std::string::npos);
+    CHECK(out.find(".8 1.328000, 338,") != std::string::npos);
+    CHECK(out.find(".8 1.327000, 337,") != std::string::npos);
+}
+
+static void testHubReset(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    sh2_SensorEvent_t event;
+
+    // After a hub reset report numbers restart, and the IDs carry on
+    stream_reset();
+    event = grvEvent(1000000, 20);
+    CHECK(stream_sendEvent(&event));
+    event = grvEvent(1010000, 21);
+    CHECK(stream_sendEvent(&event));
+    CHECK(stream_sendLog(LOG_HUB_RESET, 0, 0));
+    event = grvEvent(2000000, 0);
+    CHECK(stream_sendEvent(&event));
+    event = grvEvent(2010000, 1);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    std::string out = dsf.str();
+    CHECK(out.find(".8 1.010000, 21,") != std::string::npos);
+    CHECK(out.find(".8 2.000000, 256,") != std::string::npos);
+    CHECK(out.find(".8 2.010000, 257,") != std::string::npos);
+    CHECK(text.str() == "Sensor hub reset.\n");
+}
+
+static void testTextRecords(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    std::string line(150, 'x');
+
+    line += "\n";
+    stream_reset();
+    CHECK(stream_sendText((const uint8_t *)"ok\n", 3));
+    CHECK(stream_sendText((const uint8_t *)line.data(), (unsigned)line.size()));
+    decode(decoder);
+
+    CHECK(text.str() == "ok\n" + line);
+    CHECK(dsf.str().empty());
+    // The long line took three records
+    CHECK(decoder.stats().records == 4);
+}
+
+static void testZeroBytes(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    const uint8_t zeros[5] = { 0, 'a', 0, 0, '\n' };
+
+    stream_reset();
+    CHECK(stream_sendText(zeros, sizeof(zeros)));
+    // Only the delimiter may be zero on the wire
+    for (size_t n = 0; n + 1 < written.size(); n++) {
+        CHECK(written[n] != 0);
+    }
+    CHECK(written.back() == 0);
+    decode(decoder);
+
+    CHECK(text.str() == std::string((const char *)zeros, sizeof(zeros)));
+}
+
+static void testDroppedRecord(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    sh2_SensorEvent_t event;
+
+    stream_reset();
+    event = grvEvent(1000000, 1);
+    CHECK(stream_sendEvent(&event));
+
+    consoleFull = true;
+    event = grvEvent(1010000, 2);
+    CHECK(!stream_sendEvent(&event));
+    consoleFull = false;
+
+    event = grvEvent(1020000, 3);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    CHECK(decoder.stats().records == 2);
+    CHECK(decoder.stats().lostRecords == 1);
+    // The next record carries its delta from the last one sent
+    CHECK(dsf.str().find(".8 1.020000, 3,") != std::string::npos);
+}
+
+static void testResync(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    const uint8_t garbage[] = { 0x55, 0x12, 0x99, 0x00 };
+    sh2_SensorEvent_t event;
+
+    stream_reset();
+    // Start part way through a frame, as when a capture starts mid-stream
+    decoder.feed(garbage, sizeof(garbage));
+    event = grvEvent(3000000, 9);
+    CHECK(stream_sendEvent(&event));
+    decode(decoder);
+
+    CHECK(decoder.stats().badFrames == 1);
+    CHECK(dsf.str() == ".8 3.000000, 9, 1.000000, 0.500000, -0.500000, 0.000000\n");
+}
+
+static void testLogRecords(void)
+{
+    std::ostringstream dsf, text;
+    sh2stream::Decoder decoder(dsf, text);
+    const uint32_t lost[4] = { SH2_ROTATION_VECTOR, 3, 0, 1 };
+    const uint32_t error = (uint32_t)-6;
+    const uint32_t future[2] = { 0x12345678, 9 };
+
+    // The decoder's table is app/log_msgs.h
+    CHECK(sh2stream::numLogMsgs() == LOG_NUM_MSGS);
+    CHECK(sh2stream::logMsg(LOG_SAMPLES_LOST)->numArgs == 4);
+    CHECK(std::string(sh2stream::logMsg(LOG_HUB_RESET)->name) == "LOG_HUB_RESET");
+    CHECK(sh2stream::logMsg(LOG_NUM_MSGS) == 0);
+
+    stream_reset();
+    CHECK(stream_sendLog(LOG_HUB_RESET, 0, 0));
+    CHECK(stream_sendLog(LOG_SAMPLES_LOST, lost, 4));
+    CHECK(stream_sendLog(LOG_SH2_OPEN_ERROR, &error, 1));
+    // A message from newer firmware
+    CHECK(stream_sendLog(LOG_NUM_MSGS, future, 2));
+    decode(decoder);
+
+    std::ostringstream expected;
+    expected << "Sensor hub reset.\n"
+             << "Sensor 5: lost 3, duplicate 0, late 1 samples.\n"
+             << "Error, -6, from sh2_open.\n"
+             << "Log " << (int)LOG_NUM_MSGS << ": 0x12345678 0x00000009\n";
+    CHECK(text.str() == expected.str());
+    CHECK(decoder.stats().badFrames == 0);
+}
+
+int main(void)
+{
+    testSensorRecords();
+    testLateEvent();
+    testSequenceGap();
+    testHubReset();
+    testTextRecords();
+    testZeroBytes();
+    testDroppedRecord();
+    testResync();
+    testLogRecords();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time base: 64-bit reads across TIM2 wraps.
+ *
+ * TIM2 is simulated.  Time advances at every register access, and the
+ * wrap interrupt preempts the reader at random points, or is held off
+ * for a while as if masked or at lower priority.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "stm32f4xx_hal.h"
+#include "timebase.h"
+#include "test.h"
+
+// Wraps to run through
+#define WRAPS (10)
+
+// Largest step of simulated time per register access
+#define MAX_STEP_US (3000)
+
+extern void TIM2_IRQHandler(void);
+
+// ------------------------------------------------------------------------
+// Private data
+
+static uint64_t now_us;       // true time
+static uint32_t offset;       // TIM2 count at time 0
+static bool updateFlag;       // TIM2 update flag
+static unsigned heldOff;      // accesses the interrupt is held off for
+static bool inIrq;
+static uint32_t prescaler;    // TIM2 prescaler set by timebase_init
+
+// ------------------------------------------------------------------------
+// Simulated hardware
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preemptPriority, uint32_t subPriority)
+{
+    (void)irq;
+    (void)preemptPriority;
+    (void)subPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq)
+{
+    (void)irq;
+}
+
+// Clocked as main.c sets up: 84MHz HCLK, APB1 at half that
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return 42000000;
+}
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *clocks, uint32_t *pLatency)
+{
+    clocks->APB1CLKDivider = RCC_HCLK_DIV2;
+    clocks->APB2CLKDivider = RCC_HCLK_DIV1;
+    *pLatency = 2;
+}
+
+int HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    prescaler = htim->Init.Prescaler;
+    updateFlag = true;   // as the hardware does, loading the prescaler
+    return 0;
+}
+
+int HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+    return 0;
+}
+
+static uint32_t count(void)
+{
+    return (uint32_t)(now_us + offset);
+}
+
+// Advance time, then maybe take the wrap interrupt
+static void tick(void)
+{
+    uint32_t before = count();
+
+    if (inIrq) {
+        return;
+    }
+
+    now_us += (uint64_t)(rand() % MAX_STEP_US);
+    if (count() < before) {
+        updateFlag = true;
+    }
+
+    if (heldOff > 0) {
+        heldOff--;
+    }
+    else if ((rand() % 4) == 0) {
+        // Held off for a few accesses
+        heldOff = (unsigned)(rand() % 8);
+    }
+    else if (updateFlag && ((rand() % 2) == 0)) {
+        inIrq = true;
+        TIM2_IRQHandler();
+        inIrq = false;
+    }
+}
+
+uint32_t stub_timGetCounter(void)
+{
+    uint32_t c;
+
+    tick();
+    c = count();
+    tick();
+    return c;
+}
+
+void stub_timSetCounter(uint32_t c)
+{
+    offset = c - (uint32_t)now_us;
+}
+
+uint32_t stub_timGetFlag(void)
+{
+    uint32_t flag;
+
+    tick();
+    flag = updateFlag;
+    tick();
+    return flag;
+}
+
+void stub_timClearFlag(void)
+{
+    updateFlag = false;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+
+static void testWraps(void)
+{
+    uint64_t last = 0;
+    bool monotonic = true;
+    bool bounded = true;
+
+    srand(1);
+
+    // Start a second before the first wrap
+    now_us = 0;
+    timebase_init();
+    stub_timSetCounter(0xFFF0BDC0);
+
+    // 1MHz from the 84MHz timer clock of the half speed APB1
+    CHECK(prescaler == 83);
+
+    while (now_us < (uint64_t)WRAPS << 32) {
+        uint64_t before = now_us;
+        uint64_t t = timebase_nowUs();
+        uint64_t after = now_us;
+
+        // Clock time is true time, plus the count it started at
+        t -= 0xFFF0BDC0;
+        monotonic = monotonic && (t >= last);
+        bounded = bounded && (t >= before) && (t <= after);
+        last = t;
+
+        // Skip ahead, to a second before the next wrap
+        if (((uint32_t)(now_us + offset) < 0xFFF00000) &&
+            ((uint32_t)(now_us + offset) > 0x00100000)) {
+            now_us += 0xFFF00000 - (uint32_t)(now_us + offset);
+        }
+    }
+
+    CHECK(monotonic);
+    CHECK(bounded);
+    CHECK(last >= ((uint64_t)WRAPS << 32) - 0xFFF0BDC0);
+}
+
+int main(void)
+{
+    testWraps();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * sh2stream: convert a captured binary sensor stream to DSF text.
+ *
+ *   sh2stream [capture]
+ *   sh2stream --log-table
+ *
+ * Reads the bytes received from the demo's console UART in binary output
+ * mode, from the capture file or stdin (e.g. a serial port), and writes
+ * DSF records to stdout.  Text and log records go to stderr, followed by
+ * a summary of records decoded and lost.
+ *
+ * --log-table lists the log messages this build decodes: id, number of
+ * arguments, name and format.  Log records with ids past the table are
+ * shown with raw arguments.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "stream_decode.h"
+
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    uint8_t buf[4096];
+    size_t len;
+
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [capture | --log-table]\n";
+        return 2;
+    }
+    if ((argc == 2) && (strcmp(argv[1], "--log-table") == 0)) {
+        for (unsigned id = 0; id < sh2stream::numLogMsgs(); id++) {
+            const sh2stream::LogMsg *msg = sh2stream::logMsg(id);
+            std::cout << id << "\t" << msg->numArgs << "\t" << msg->name
+                      << "\t" << msg->format;
+        }
+        return 0;
+    }
+    if (argc == 2) {
+        in = fopen(argv[1], "rb");
+        if (in == 0) {
+            std::cerr << "Can't open " << argv[1] << "\n";
+            return 1;
+        }
+    }
+
+    sh2stream::Decoder decoder(std::cout, std::cerr);
+    decoder.writeHeaders();
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+        decoder.feed(buf, len);
+    }
+
+    const sh2stream::DecodeStats &stats = decoder.stats();
+    std::cerr << "Stream: " << stats.records << " records, "
+              << stats.lostRecords << " lost, "
+              << stats.badFrames << " bad frames, "
+              << stats.unknownSensors << " from sensors without a DSF format\n";
+
+    return 0;
+}
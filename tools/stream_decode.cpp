@@ -0,0 +1,367 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host side decoder for the binary sensor stream.
+ *
+ * Sensor reports are decoded with the Q points given in the SH-2 reference
+ * manual, and printed as printDsf in demo_app.c prints them.
+ */
+
+#include "stream_decode.h"
+
+#include <cstdio>
+#include <string>
+
+namespace sh2stream {
+
+// Sensor report ids with a DSF format
+enum {
+    ACCELEROMETER = 0x01,
+    MAGNETIC_FIELD_CALIBRATED = 0x03,
+    ROTATION_VECTOR = 0x05,
+    GAME_ROTATION_VECTOR = 0x08,
+    RAW_ACCELEROMETER = 0x14,
+    RAW_GYROSCOPE = 0x15,
+    RAW_MAGNETOMETER = 0x16,
+    GYRO_INTEGRATED_RV = 0x2A,
+};
+
+// Log message ids, as app/log.h numbers them
+enum {
+#define LOG_MSG(id, numArgs, format) id,
+#include "log_msgs.h"
+#undef LOG_MSG
+};
+
+// Log messages, indexed by id, as app/log.c builds its table
+static const LogMsg logMsgs[] = {
+#define LOG_MSG(id, numArgs, format) {#id, numArgs, format},
+#include "log_msgs.h"
+#undef LOG_MSG
+};
+
+// Most arguments a log message may have (LOG_MAX_ARGS in app/log.h)
+const unsigned LOG_MAX_ARGS = 4;
+
+// Longest frame accepted.  (The target sends much shorter ones.)
+const size_t MAX_FRAME_LEN = 1024;
+
+// ------------------------------------------------------------------------
+// Private functions
+
+static int16_t read16(const uint8_t *p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+// Value of a 16-bit fixed point field with q fraction bits
+static float readQ(const uint8_t *p, int q)
+{
+    return read16(p) * (1.0f / (float)(1 << q));
+}
+
+// Append ", " and a value formatted as the demo does
+static void putFloat(std::string &line, float x)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), ", %0.6f", (double)x);
+    line += buf;
+}
+
+static void putInt(std::string &line, int32_t x)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), ", %d", (int)x);
+    line += buf;
+}
+
+// Read an unsigned LEB128 varint.  Returns the bytes used, 0 if malformed.
+static size_t getVarint(const uint8_t *p, size_t len, uint64_t &value)
+{
+    value = 0;
+    for (size_t n = 0; (n < len) && (n < 10); n++) {
+        value |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if ((p[n] & 0x80) == 0) {
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------------
+// Public API
+
+unsigned numLogMsgs()
+{
+    return sizeof(logMsgs) / sizeof(logMsgs[0]);
+}
+
+const LogMsg *logMsg(unsigned id)
+{
+    return (id < numLogMsgs()) ? &logMsgs[id] : 0;
+}
+
+bool cobsDecode(const uint8_t *pFrame, size_t len, std::vector<uint8_t> &record)
+{
+    size_t n = 0;
+
+    record.clear();
+    while (n < len) {
+        uint8_t code = pFrame[n++];
+        if ((code == 0) || (n + code - 1 > len)) {
+            return false;
+        }
+        record.insert(record.end(), pFrame + n, pFrame + n + code - 1);
+        n += code - 1;
+        if ((code != 0xFF) && (n < len)) {
+            record.push_back(0);
+        }
+    }
+
+    return true;
+}
+
+Decoder::Decoder(std::ostream &dsf, std::ostream &text)
+    : dsf_(dsf), text_(text), started_(false), nextSequence_(0),
+      timestamp_us_(0), sequences_(), stats_()
+{
+}
+
+void Decoder::writeHeaders()
+{
+    dsf_ << "+" << (int)ROTATION_VECTOR << " TIME[x]{s}, SAMPLE_ID[x]{samples}, ANG_POS_GLOBAL[rijk]{quaternion}, ANG_POS_ACCURACY[x]{rad}\n";
+    dsf_ << "+" << (int)GAME_ROTATION_VECTOR << " TIME[x]{s}, SAMPLE_ID[x]{samples}, GAME_ROTATION_VECTOR[rijk]{quaternion}\n";
+    dsf_ << "+" << (int)RAW_ACCELEROMETER << " TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_ACCELEROMETER[xyz]{adc units}\n";
+    dsf_ << "+" << (int)RAW_MAGNETOMETER << " TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_MAGNETOMETER[xyz]{adc units}\n";
+    dsf_ << "+" << (int)RAW_GYROSCOPE << " TIME[x]{s}, SAMPLE_ID[x]{samples}, RAW_GYROSCOPE[xyz]{adc units}\n";
+    dsf_ << "+" << (int)ACCELEROMETER << " TIME[x]{s}, SAMPLE_ID[x]{samples}, ACCELEROMETER[xyz]{m/s^2}\n";
+    dsf_ << "+" << (int)MAGNETIC_FIELD_CALIBRATED << " TIME[x]{s}, SAMPLE_ID[x]{samples}, MAG_FIELD[xyz]{uTesla}, STATUS[x]{enum}\n";
+    dsf_ << "+" << (int)GYRO_INTEGRATED_RV << " TIME[x]{s}, ANG_VEL_GYRO_RV[xyz]{rad/s}, ANG_POS_GYRO_RV[wxyz]{quaternion}\n";
+}
+
+void Decoder::feed(const uint8_t *pData, size_t len)
+{
+    for (size_t n = 0; n < len; n++) {
+        if (pData[n] == 0) {
+            if (!frame_.empty()) {
+                frame(frame_.data(), frame_.size());
+                frame_.clear();
+            }
+        }
+        else if (frame_.size() < MAX_FRAME_LEN) {
+            frame_.push_back(pData[n]);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// Private methods
+
+void Decoder::frame(const uint8_t *pFrame, size_t len)
+{
+    std::vector<uint8_t> rec;
+
+    if ((len > MAX_FRAME_LEN - 1) || !cobsDecode(pFrame, len, rec) || (rec.size() < 2)) {
+        stats_.badFrames++;
+        return;
+    }
+    record(rec);
+}
+
+void Decoder::record(const std::vector<uint8_t> &rec)
+{
+    uint8_t id = rec[0];
+    uint8_t sequence = rec[1];
+
+    stats_.records++;
+    if (started_) {
+        stats_.lostRecords += (uint8_t)(sequence - nextSequence_);
+    }
+    started_ = true;
+    nextSequence_ = sequence + 1;
+
+    if (id == TEXT_ID) {
+        text_.write((const char *)&rec[2], rec.size() - 2);
+    }
+    else if (id == LOG_ID) {
+        logRecord(&rec[2], rec.size() - 2);
+    }
+    else {
+        uint64_t delta;
+        size_t used = getVarint(&rec[2], rec.size() - 2, delta);
+        if (used == 0) {
+            stats_.badFrames++;
+            return;
+        }
+        // Zig-zag decode the signed delta
+        timestamp_us_ += (delta >> 1) ^ (0 - (delta & 1));
+        sensorRecord(id, timestamp_us_, &rec[2 + used], rec.size() - 2 - used);
+    }
+}
+
+void Decoder::logRecord(const uint8_t *pData, size_t len)
+{
+    char buf[256];
+    uint32_t args[LOG_MAX_ARGS] = {0};
+    unsigned numArgs;
+    unsigned id;
+    const LogMsg *msg;
+
+    if (len < 2) {
+        stats_.badFrames++;
+        return;
+    }
+    id = pData[0] | (pData[1] << 8);
+    numArgs = (unsigned)((len - 2) / 4);
+    if (numArgs > LOG_MAX_ARGS) {
+        numArgs = LOG_MAX_ARGS;
+    }
+    for (unsigned n = 0; n < numArgs; n++) {
+        const uint8_t *p = &pData[2 + 4*n];
+        args[n] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    if (id == LOG_HUB_RESET) {
+        // Report sequence numbers restart, tracking does as the demo's does
+        for (unsigned n = 0; n < sizeof(sequences_) / sizeof(sequences_[0]); n++) {
+            sequences_[n].started = false;
+        }
+    }
+
+    msg = logMsg(id);
+    if ((msg == 0) || (numArgs != msg->numArgs)) {
+        // Not in this decoder's table: show the id and raw arguments
+        snprintf(buf, sizeof(buf), "Log %u:", id);
+        text_ << buf;
+        for (unsigned n = 0; n < numArgs; n++) {
+            snprintf(buf, sizeof(buf), " 0x%08x", (unsigned)args[n]);
+            text_ << buf;
+        }
+        text_ << "\n";
+        return;
+    }
+
+    // Formats take only %d, %u and %x of 32-bit arguments
+    snprintf(buf, sizeof(buf), msg->format, args[0], args[1], args[2], args[3]);
+    text_ << buf;
+}
+
+// SAMPLE_ID of a report, extended as the demo extends it.  (The demo
+// accounts for reports its output policies skip too, which are seen here
+// as lost.)
+uint32_t Decoder::extendSequence(uint8_t sensorId, uint8_t sequence)
+{
+    SequenceStats_t *pStats = &sequences_[sensorId];
+
+    sequence_check(pStats, sequence);
+    return sequence_extend(pStats, sequence);
+}
+
+void Decoder::sensorRecord(uint8_t sensorId, uint64_t timestamp_us,
+                           const uint8_t *r, size_t len)
+{
+    std::string line;
+    char buf[48];
+    // Reports other than gyro integrated RV have a 4 byte header:
+    // id, sequence, status, delay.  Values follow.
+    size_t need = 0;
+
+    switch (sensorId) {
+        case RAW_ACCELEROMETER:
+        case RAW_GYROSCOPE:
+        case RAW_MAGNETOMETER:
+        case ACCELEROMETER:
+        case MAGNETIC_FIELD_CALIBRATED:
+            need = 10;
+            break;
+        case ROTATION_VECTOR:
+            need = 14;
+            break;
+        case GAME_ROTATION_VECTOR:
+            need = 12;
+            break;
+        case GYRO_INTEGRATED_RV:
+            need = 14;
+            break;
+        default:
+            stats_.unknownSensors++;
+            return;
+    }
+    if (len < need) {
+        stats_.badFrames++;
+        return;
+    }
+
+    snprintf(buf, sizeof(buf), ".%d %llu.%06llu", sensorId,
+             (unsigned long long)(timestamp_us / 1000000),
+             (unsigned long long)(timestamp_us % 1000000));
+    line = buf;
+    if (sensorId != GYRO_INTEGRATED_RV) {
+        snprintf(buf, sizeof(buf), ", %u", (unsigned)extendSequence(sensorId, r[1]));
+        line += buf;
+    }
+
+    switch (sensorId) {
+        case RAW_ACCELEROMETER:
+        case RAW_GYROSCOPE:
+        case RAW_MAGNETOMETER:
+            putInt(line, read16(&r[4]));
+            putInt(line, read16(&r[6]));
+            putInt(line, read16(&r[8]));
+            break;
+        case MAGNETIC_FIELD_CALIBRATED:
+            putFloat(line, readQ(&r[4], 4));
+            putFloat(line, readQ(&r[6], 4));
+            putFloat(line, readQ(&r[8], 4));
+            putInt(line, r[2] & 0x3);
+            break;
+        case ACCELEROMETER:
+            putFloat(line, readQ(&r[4], 8));
+            putFloat(line, readQ(&r[6], 8));
+            putFloat(line, readQ(&r[8], 8));
+            break;
+        case ROTATION_VECTOR:
+            // Reported as i, j, k, real, accuracy
+            putFloat(line, readQ(&r[10], 14));
+            putFloat(line, readQ(&r[4], 14));
+            putFloat(line, readQ(&r[6], 14));
+            putFloat(line, readQ(&r[8], 14));
+            putFloat(line, readQ(&r[12], 12));
+            break;
+        case GAME_ROTATION_VECTOR:
+            putFloat(line, readQ(&r[10], 14));
+            putFloat(line, readQ(&r[4], 14));
+            putFloat(line, readQ(&r[6], 14));
+            putFloat(line, readQ(&r[8], 14));
+            break;
+        case GYRO_INTEGRATED_RV:
+            // No header: i, j, k, real, then angular velocity x, y, z
+            putFloat(line, readQ(&r[8], 10));
+            putFloat(line, readQ(&r[10], 10));
+            putFloat(line, readQ(&r[12], 10));
+            putFloat(line, readQ(&r[6], 14));
+            putFloat(line, readQ(&r[0], 14));
+            putFloat(line, readQ(&r[2], 14));
+            putFloat(line, readQ(&r[4], 14));
+            break;
+    }
+
+    dsf_ << line << "\n";
+}
+
+} // namespace sh2stream
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Hillcrest Laboratories, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License and 
+ * any applicable agreements you may have with Hillcrest Laboratories, Inc.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host side decoder for the binary sensor stream (see app/stream.h).
+ *
+ * Bytes received from the console UART are split into COBS frames.  Sensor
+ * records are written as DSF text, the same as the demo's dsf output
+ * format.  Text and log records go to a second stream, so the DSF output
+ * stays clean.  Log records are formatted with the message table from
+ * app/log_msgs.h, built in at compile time.
+ */
+
+#ifndef STREAM_DECODE_H
+#define STREAM_DECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+extern "C" {
+#include "sequence.h"
+}
+
+namespace sh2stream {
+
+// Record ids, as in app/stream.h
+const uint8_t LOG_ID = 0xFF;
+const uint8_t TEXT_ID = 0xFE;
+
+// Log message, from app/log_msgs.h
+struct LogMsg {
+    const char *name;
+    unsigned numArgs;
+    const char *format;
+};
+
+// Number of log messages this decoder knows.
+unsigned numLogMsgs();
+
+// Log message for an id.  Returns 0 if the id is unknown (e.g. a message
+// added to newer firmware).
+const LogMsg *logMsg(unsigned id);
+
+// Decode one COBS frame, without its zero delimiter.
+// Returns false if the frame is malformed.
+bool cobsDecode(const uint8_t *pFrame, size_t len, std::vector<uint8_t> &record);
+
+// Decoder statistics
+struct DecodeStats {
+    uint32_t records;        // records decoded
+    uint32_t badFrames;      // frames that could not be decoded
+    uint32_t lostRecords;    // records missing from the stream sequence
+    uint32_t unknownSensors; // sensor records with no DSF format
+};
+
+class Decoder {
+public:
+    // DSF records are written to dsf, text and log records to text.
+    Decoder(std::ostream &dsf, std::ostream &text);
+
+    // Write the DSF header lines for the sensors that have a DSF format.
+    void writeHeaders();
+
+    // Decode bytes received from the UART.  Frames may span calls.
+    void feed(const uint8_t *pData, size_t len);
+
+    const DecodeStats &stats() const { return stats_; }
+
+private:
+    void frame(const uint8_t *pFrame, size_t len);
+    void record(const std::vector<uint8_t> &rec);
+    void sensorRecord(uint8_t sensorId, uint64_t timestamp_us,
+                      const uint8_t *pReport, size_t len);
+    void logRecord(const uint8_t *pData, size_t len);
+    uint32_t extendSequence(uint8_t sensorId, uint8_t sequence);
+
+    std::ostream &dsf_;
+    std::ostream &text_;
+    std::vector<uint8_t> frame_;
+    bool started_;
+    uint8_t nextSequence_;
+    uint64_t timestamp_us_;
+    SequenceStats_t sequences_[256];  // per sensor, as the demo keeps them
+    DecodeStats stats_;
+};
+
+} // namespace sh2stream
+
+#endif